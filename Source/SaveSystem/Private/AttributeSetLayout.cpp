@@ -0,0 +1,97 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "AttributeSetLayout.h"
+#include "SaveGameData.h"
+#include "SaveSystemLogChannels.h"
+
+#include "AttributeSet.h"
+
+namespace
+{
+	FGameplayAttributeData& GetAttributeData(UAttributeSet* AttributeSet, int32 Offset)
+	{
+		return *reinterpret_cast<FGameplayAttributeData*>(reinterpret_cast<uint8*>(AttributeSet) + Offset);
+	}
+
+	const FGameplayAttributeData& GetAttributeData(const UAttributeSet* AttributeSet, int32 Offset)
+	{
+		return *reinterpret_cast<const FGameplayAttributeData*>(reinterpret_cast<const uint8*>(AttributeSet) + Offset);
+	}
+}
+
+const FAttributeSetLayout& FAttributeSetLayout::Get(const UClass* AttributeSetClass)
+{
+	check(IsInGameThread());
+
+	// Keys of unloaded classes are never matched again, so stale layouts are only a small leak
+	static TMap<FObjectKey, TUniquePtr<FAttributeSetLayout>> Layouts;
+
+	TUniquePtr<FAttributeSetLayout>& Layout = Layouts.FindOrAdd(FObjectKey(AttributeSetClass));
+	if (!Layout)
+	{
+		Layout.Reset(new FAttributeSetLayout(AttributeSetClass));
+	}
+
+	return *Layout;
+}
+
+FAttributeSetLayout::FAttributeSetLayout(const UClass* AttributeSetClass)
+	: SetName(AttributeSetClass->GetFName())
+{
+	for (TFieldIterator<FProperty> It(AttributeSetClass, EFieldIterationFlags::IncludeSuper); It; ++It)
+	{
+		FProperty* Property = *It;
+
+		if (FGameplayAttribute::IsGameplayAttributeDataProperty(Property))
+		{
+			AttributeNames.Add(Property->GetFName());
+			Offsets.Add(Property->GetOffset_ForInternal());
+		}
+	}
+}
+
+void FAttributeSetLayout::Save(const UAttributeSet* AttributeSet, FAttributeSetSaveData& OutSaveData) const
+{
+	OutSaveData.SetName = SetName;
+	OutSaveData.AttributeNames = AttributeNames;
+	OutSaveData.BaseValues.SetNumUninitialized(Offsets.Num());
+
+	for (int32 Index = 0; Index != Offsets.Num(); ++Index)
+	{
+		OutSaveData.BaseValues[Index] = GetAttributeData(AttributeSet, Offsets[Index]).GetBaseValue();
+	}
+}
+
+void FAttributeSetLayout::Load(UAttributeSet* AttributeSet, const FAttributeSetSaveData& SaveData) const
+{
+	if (SaveData.AttributeNames.Num() != SaveData.BaseValues.Num())
+	{
+		UE_LOG(LogSaveSystem, Warning, TEXT("Saved attributes of %s are malformed"), *SetName.ToString());
+		return;
+	}
+
+	if (SaveData.AttributeNames == AttributeNames)
+	{
+		for (int32 Index = 0; Index != Offsets.Num(); ++Index)
+		{
+			FGameplayAttributeData& Data = GetAttributeData(AttributeSet, Offsets[Index]);
+			Data.SetBaseValue(SaveData.BaseValues[Index]);
+			Data.SetCurrentValue(SaveData.BaseValues[Index]);
+		}
+		return;
+	}
+
+	UE_LOG(LogSaveSystem, Verbose, TEXT("Attributes of %s changed since they were saved, restoring them by name"), *SetName.ToString());
+
+	// Attributes that were added since the save keep their defaults, removed ones are dropped
+	for (int32 Index = 0; Index != Offsets.Num(); ++Index)
+	{
+		const int32 SavedIndex = SaveData.AttributeNames.IndexOfByKey(AttributeNames[Index]);
+		if (SavedIndex != INDEX_NONE)
+		{
+			FGameplayAttributeData& Data = GetAttributeData(AttributeSet, Offsets[Index]);
+			Data.SetBaseValue(SaveData.BaseValues[SavedIndex]);
+			Data.SetCurrentValue(SaveData.BaseValues[SavedIndex]);
+		}
+	}
+}
@@ -0,0 +1,35 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "UObject/ObjectKey.h"
+
+class UAttributeSet;
+struct FAttributeSetSaveData;
+
+/**
+ * Gameplay attribute properties of an attribute set class, found once instead of on every save and load.
+ * Values are saved in the order of the layout, so a set whose layout didn't change is restored with a single pass.
+ */
+class FAttributeSetLayout
+{
+public:
+	/** Layout of the class, built on first use. Game thread only. */
+	static const FAttributeSetLayout& Get(const UClass* AttributeSetClass);
+
+	void Save(const UAttributeSet* AttributeSet, FAttributeSetSaveData& OutSaveData) const;
+
+	/** Falls back to finding values by name if the set was saved with another layout. */
+	void Load(UAttributeSet* AttributeSet, const FAttributeSetSaveData& SaveData) const;
+
+	FName GetSetName() const { return SetName; }
+
+private:
+	explicit FAttributeSetLayout(const UClass* AttributeSetClass);
+
+	FName SetName;
+	TArray<FName> AttributeNames;
+
+	// Offsets of the FGameplayAttributeData properties in the set
+	TArray<int32> Offsets;
+};
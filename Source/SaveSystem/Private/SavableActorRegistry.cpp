@@ -0,0 +1,172 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SavableActorRegistry.h"
+#include "SavableObjectInterface.h"
+
+#include "Engine/Level.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SavableActorRegistry)
+
+void USavableActorRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	check(World);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &ThisClass::HandleLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &ThisClass::HandleLevelRemoved);
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ThisClass::HandleActorSpawned));
+	ActorDestroyedHandle = World->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &ThisClass::HandleActorDestroyed));
+}
+
+void USavableActorRegistry::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyedHandler(ActorDestroyedHandle);
+	}
+
+	Levels.Empty();
+	
+	Super::Deinitialize();
+}
+
+void USavableActorRegistry::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Levels that were loaded together with the world do not go through LevelAddedToWorld
+	for (ULevel* Level : InWorld.GetLevels())
+	{
+		RegisterLevel(Level);
+	}
+}
+
+void USavableActorRegistry::RegisterActor(AActor* Actor)
+{
+	if (!IsValid(Actor) || !Actor->Implements<USavableObjectInterface>())
+	{
+		return;
+	}
+
+	FSavableLevelActors& LevelActors = FindOrAddLevel(Actor->GetLevel());
+	LevelActors.Actors.Add(Actor);
+}
+
+void USavableActorRegistry::UnregisterActor(AActor* Actor)
+{
+	if (!Actor)
+	{
+		return;
+	}
+
+	if (FSavableLevelActors* LevelActors = Levels.Find(Actor->GetLevel()))
+	{
+		LevelActors->Actors.Remove(Actor);
+	}
+}
+
+int32 USavableActorRegistry::GetNumActors() const
+{
+	int32 NumActors = 0;
+	for (const TPair<TObjectKey<ULevel>, FSavableLevelActors>& Pair : Levels)
+	{
+		NumActors += Pair.Value.Actors.Num();
+	}
+
+	return NumActors;
+}
+
+FString USavableActorRegistry::GetLevelKey(const ULevel* Level)
+{
+	return UWorld::RemovePIEPrefix(Level->GetOutermost()->GetName());
+}
+
+bool USavableActorRegistry::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void USavableActorRegistry::RegisterLevel(ULevel* Level)
+{
+	if (!Level)
+	{
+		return;
+	}
+
+	FSavableLevelActors& LevelActors = FindOrAddLevel(Level);
+	
+	for (AActor* Actor : Level->Actors)
+	{
+		if (IsValid(Actor) && Actor->Implements<USavableObjectInterface>())
+		{
+			LevelActors.Actors.Add(Actor);
+		}
+	}
+
+	OnLevelAdded.Broadcast(LevelActors);
+}
+
+FSavableLevelActors& USavableActorRegistry::FindOrAddLevel(ULevel* Level)
+{
+	FSavableLevelActors& LevelActors = Levels.FindOrAdd(Level);
+	
+	if (LevelActors.Key.IsEmpty())
+	{
+		LevelActors.Level = Level;
+		LevelActors.Key = GetLevelKey(Level);
+	}
+
+	return LevelActors;
+}
+
+void USavableActorRegistry::HandleLevelAdded(ULevel* Level, UWorld* InWorld)
+{
+	if (InWorld == GetWorld())
+	{
+		RegisterLevel(Level);
+	}
+}
+
+void USavableActorRegistry::HandleLevelRemoved(ULevel* Level, UWorld* InWorld)
+{
+	if (InWorld != GetWorld())
+	{
+		return;
+	}
+
+	// A null level means that all levels of the world are being removed
+	if (Level)
+	{
+		if (const FSavableLevelActors* LevelActors = Levels.Find(Level))
+		{
+			OnLevelRemoving.Broadcast(*LevelActors);
+			Levels.Remove(Level);
+		}
+	}
+	else
+	{
+		for (const TPair<TObjectKey<ULevel>, FSavableLevelActors>& Pair : Levels)
+		{
+			OnLevelRemoving.Broadcast(Pair.Value);
+		}
+		
+		Levels.Empty();
+	}
+}
+
+void USavableActorRegistry::HandleActorSpawned(AActor* Actor)
+{
+	RegisterActor(Actor);
+}
+
+void USavableActorRegistry::HandleActorDestroyed(AActor* Actor)
+{
+	UnregisterActor(Actor);
+}
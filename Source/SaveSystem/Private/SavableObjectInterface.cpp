@@ -2,5 +2,16 @@
 
 
 #include "SavableObjectInterface.h"
+#include "SaveDirtyTracker.h"
 
 // Add default functionality here for any ISavableActorInterface functions that are not pure virtual.
+
+void ISavableObjectInterface::MarkSaveDirty(const UObject* Object)
+{
+	FSaveDirtyTracker::Get().Mark(Object, ESaveDirtyFlags::All);
+}
+
+void ISavableObjectInterface::MarkSaveTransformDirty(const UObject* Object)
+{
+	FSaveDirtyTracker::Get().Mark(Object, ESaveDirtyFlags::Transform);
+}
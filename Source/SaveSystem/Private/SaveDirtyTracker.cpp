@@ -0,0 +1,38 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveDirtyTracker.h"
+
+#include "Misc/ScopeLock.h"
+
+FSaveDirtyTracker& FSaveDirtyTracker::Get()
+{
+	static FSaveDirtyTracker Tracker;
+	return Tracker;
+}
+
+void FSaveDirtyTracker::Mark(const UObject* Object, ESaveDirtyFlags Flags)
+{
+	if (!Object || Flags == ESaveDirtyFlags::None)
+	{
+		return;
+	}
+
+	const FObjectKey Key(Object);
+	
+	FScopeLock ScopeLock(&Lock);
+	DirtyObjects.FindOrAdd(Key) |= Flags;
+}
+
+void FSaveDirtyTracker::Consume(TMap<FObjectKey, ESaveDirtyFlags>& OutDirtyObjects)
+{
+	OutDirtyObjects.Reset();
+	
+	FScopeLock ScopeLock(&Lock);
+	Swap(OutDirtyObjects, DirtyObjects);
+}
+
+void FSaveDirtyTracker::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	DirtyObjects.Reset();
+}
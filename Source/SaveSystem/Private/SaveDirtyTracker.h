@@ -0,0 +1,28 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "SavableObjectInterface.h"
+#include "UObject/ObjectKey.h"
+#include "HAL/CriticalSection.h"
+
+/**
+ * Collects objects marked through ISavableObjectInterface::MarkSaveDirty until the next capture consumes them.
+ * All functions are thread safe.
+ */
+class FSaveDirtyTracker
+{
+public:
+	static FSaveDirtyTracker& Get();
+
+	void Mark(const UObject* Object, ESaveDirtyFlags Flags);
+
+	/** Moves every flag accumulated since the previous call into OutDirtyObjects. */
+	void Consume(TMap<FObjectKey, ESaveDirtyFlags>& OutDirtyObjects);
+	
+	void Reset();
+
+private:
+	FCriticalSection Lock;
+	TMap<FObjectKey, ESaveDirtyFlags> DirtyObjects;
+};
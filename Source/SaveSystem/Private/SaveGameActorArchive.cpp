@@ -0,0 +1,256 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveGameActorArchive.h"
+#include "SaveSystemLogChannels.h"
+
+#include "UObject/SoftObjectPtr.h"
+#include "UObject/LazyObjectPtr.h"
+
+FSaveGameActorArchive::FWriter::FWriter(const FSaveGameStringTable& InitialTable)
+	: Table(InitialTable)
+{
+	NameIndices.Reserve(Table.Names.Num());
+	for (int32 Index = 0; Index != Table.Names.Num(); ++Index)
+	{
+		NameIndices.Add(Table.Names[Index], Index);
+	}
+
+	PathIndices.Reserve(Table.ObjectPaths.Num());
+	for (int32 Index = 0; Index != Table.ObjectPaths.Num(); ++Index)
+	{
+		PathIndices.Add(Table.ObjectPaths[Index], Index);
+	}
+
+	for (int32 Index = 0; Index != Table.PropertySchemas.Num(); ++Index)
+	{
+		SchemaIndices.Add(Table.PropertySchemas[Index].Hash, Index);
+	}
+}
+
+int32 FSaveGameActorArchive::FWriter::AddName(FName Name)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (const int32* Index = NameIndices.Find(Name))
+	{
+		return *Index;
+	}
+
+	const int32 Index = Table.Names.Add(Name);
+	NameIndices.Add(Name, Index);
+	return Index;
+}
+
+int32 FSaveGameActorArchive::FWriter::AddObject(UObject* Object)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	// Objects are usually referenced by many actors, so the path is only built the first time
+	if (const int32* Index = ObjectIndices.Find(Object))
+	{
+		return *Index;
+	}
+
+	const int32 Index = AddObjectPathLocked(Object->GetPathName());
+	ObjectIndices.Add(Object, Index);
+	return Index;
+}
+
+int32 FSaveGameActorArchive::FWriter::AddObjectPath(const FString& Path)
+{
+	FScopeLock Lock(&CriticalSection);
+	return AddObjectPathLocked(Path);
+}
+
+int32 FSaveGameActorArchive::FWriter::AddPropertySchema(const FSavePropertySchema& Schema)
+{
+	FScopeLock Lock(&CriticalSection);
+
+	if (const int32* Index = SchemaIndices.Find(Schema.Hash))
+	{
+		const FSavePropertySchema& Existing = Table.PropertySchemas[*Index];
+		if (Existing.Names == Schema.Names && Existing.Types == Schema.Types)
+		{
+			return *Index;
+		}
+	}
+
+	// Classes with the same properties share a schema. A colliding hash only misses the lookup next time
+	const int32 Index = Table.PropertySchemas.Add(Schema);
+	SchemaIndices.FindOrAdd(Schema.Hash, Index);
+	return Index;
+}
+
+int32 FSaveGameActorArchive::FWriter::AddObjectPathLocked(const FString& Path)
+{
+	if (const int32* Index = PathIndices.Find(Path))
+	{
+		return *Index;
+	}
+
+	const int32 Index = Table.ObjectPaths.Add(Path);
+	PathIndices.Add(Path, Index);
+	return Index;
+}
+
+FSaveGameActorArchive::FReader::FReader(const FSaveGameStringTable& InTable, bool bInLoadIfFindFails)
+	: Table(InTable)
+	, ResolvedObjects(false, InTable.ObjectPaths.Num())
+	, bLoadIfFindFails(bInLoadIfFindFails)
+{
+	Objects.SetNumZeroed(Table.ObjectPaths.Num());
+}
+
+UObject* FSaveGameActorArchive::FReader::GetObject(int32 Index)
+{
+	if (!ResolvedObjects[Index])
+	{
+		const FString& Path = Table.ObjectPaths[Index];
+		UObject* Object = FindObject<UObject>(nullptr, *Path, false);
+
+		if (!Object && bLoadIfFindFails)
+		{
+			Object = LoadObject<UObject>(nullptr, *Path);
+		}
+
+		Objects[Index] = Object;
+		ResolvedObjects[Index] = true;
+	}
+
+	return Objects[Index];
+}
+
+bool FSaveGameActorArchive::FReader::MatchesPropertySchema(int32 Index, const FSavePropertySchema& Schema)
+{
+	// Schemas of current classes are never freed, so their address identifies them
+	const TPair<int32, const FSavePropertySchema*> Key(Index, &Schema);
+	if (const bool* bMatches = PropertySchemaMatches.Find(Key))
+	{
+		return *bMatches;
+	}
+
+	const FSavePropertySchema& SavedSchema = Table.PropertySchemas[Index];
+	const bool bMatches = SavedSchema.Hash == Schema.Hash && SavedSchema.Names == Schema.Names && SavedSchema.Types == Schema.Types;
+	PropertySchemaMatches.Add(Key, bMatches);
+	return bMatches;
+}
+
+FSaveGameActorArchive::FSaveGameActorArchive(FArchive& InInnerArchive, FWriter& InWriter)
+	: FArchiveProxy(InInnerArchive)
+	, Writer(&InWriter)
+{
+}
+
+FSaveGameActorArchive::FSaveGameActorArchive(FArchive& InInnerArchive, FReader& InReader)
+	: FArchiveProxy(InInnerArchive)
+	, Reader(&InReader)
+{
+}
+
+FArchive& FSaveGameActorArchive::operator<<(FName& Value)
+{
+	int32 Index = INDEX_NONE;
+	if (IsSaving())
+	{
+		Index = Writer->AddName(Value);
+		InnerArchive << Index;
+		return *this;
+	}
+
+	InnerArchive << Index;
+	if (Reader->IsValidName(Index))
+	{
+		Value = Reader->GetName(Index);
+	}
+	else
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Saved actor references name %d, which does not exist."), Index);
+		Value = NAME_None;
+		SetError();
+	}
+
+	return *this;
+}
+
+FArchive& FSaveGameActorArchive::operator<<(UObject*& Value)
+{
+	int32 Index = INDEX_NONE;
+	if (IsSaving())
+	{
+		Index = Value ? Writer->AddObject(Value) : INDEX_NONE;
+		InnerArchive << Index;
+		return *this;
+	}
+
+	InnerArchive << Index;
+	Value = nullptr;
+
+	if (Index != INDEX_NONE)
+	{
+		if (Reader->IsValidObjectPath(Index))
+		{
+			Value = Reader->GetObject(Index);
+		}
+		else
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("Saved actor references object %d, which does not exist."), Index);
+			SetError();
+		}
+	}
+
+	return *this;
+}
+
+FArchive& FSaveGameActorArchive::operator<<(FObjectPtr& Value)
+{
+	return FArchiveUObject::SerializeObjectPtr(*this, Value);
+}
+
+FArchive& FSaveGameActorArchive::operator<<(FWeakObjectPtr& Value)
+{
+	return FArchiveUObject::SerializeWeakObjectPtr(*this, Value);
+}
+
+FArchive& FSaveGameActorArchive::operator<<(FSoftObjectPtr& Value)
+{
+	return FArchiveUObject::SerializeSoftObjectPtr(*this, Value);
+}
+
+FArchive& FSaveGameActorArchive::operator<<(FSoftObjectPath& Value)
+{
+	int32 Index = INDEX_NONE;
+	if (IsSaving())
+	{
+		Index = Value.IsNull() ? INDEX_NONE : Writer->AddObjectPath(Value.ToString());
+		InnerArchive << Index;
+		return *this;
+	}
+
+	InnerArchive << Index;
+	Value.Reset();
+
+	if (Index != INDEX_NONE)
+	{
+		if (Reader->IsValidObjectPath(Index))
+		{
+			Value.SetPath(Reader->GetObjectPath(Index));
+		}
+		else
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("Saved actor references object path %d, which does not exist."), Index);
+			SetError();
+		}
+	}
+
+	return *this;
+}
+
+FArchive& FSaveGameActorArchive::operator<<(FLazyObjectPtr& Value)
+{
+	return FArchiveUObject::SerializeLazyObjectPtr(*this, Value);
+}
+
+FString FSaveGameActorArchive::GetArchiveName() const
+{
+	return TEXT("FSaveGameActorArchive");
+}
@@ -0,0 +1,568 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveGameContainer.h"
+#include "SaveSystemLogChannels.h"
+#include "SaveSystemStats.h"
+
+#include "Compression/OodleDataCompression.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/Class.h"
+
+namespace
+{
+	// Save files belong to the platform save system, which may not store them as plain files
+	bool GetSaveGameSlotName(const FString& Filename, FString& OutSlotName)
+	{
+		const FString SaveDirectory = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("SaveGames"));
+		FString FullFilename = FPaths::ConvertRelativePathToFull(Filename);
+		if (FPaths::GetExtension(FullFilename) != TEXT("sav") || !FPaths::IsUnderDirectory(FullFilename, SaveDirectory))
+		{
+			return false;
+		}
+
+		FPaths::MakePathRelativeTo(FullFilename, *(SaveDirectory / TEXT("")));
+		OutSlotName = FPaths::GetBaseFilename(FullFilename, false);
+		return true;
+	}
+
+	ISaveGameSystem& GetSaveGameSystem()
+	{
+		return *IPlatformFeaturesModule::Get().GetSaveGameSystem();
+	}
+}
+
+FSaveGameFileVersions::FSaveGameFileVersions()
+	: UEVersion(GPackageFileUEVersion)
+	, EngineVersion(FEngineVersion::Current())
+	, CustomVersions(FCurrentCustomVersions::GetAll())
+{
+}
+
+void FSaveGameFileVersions::Serialize(FArchive& Ar)
+{
+	Ar << UEVersion;
+	Ar << EngineVersion;
+	CustomVersions.Serialize(Ar, ECustomVersionSerializationFormat::Optimized);
+}
+
+bool FSaveGameFileVersions::IsCurrent() const
+{
+	if (UEVersion != GPackageFileUEVersion || !EngineVersion.ExactMatch(FEngineVersion::Current()))
+	{
+		return false;
+	}
+
+	for (const FCustomVersion& CustomVersion : CustomVersions.GetAllVersions())
+	{
+		const TOptional<FCustomVersion> CurrentVersion = FCurrentCustomVersions::Get(CustomVersion.Key);
+		if (!CurrentVersion.IsSet() || CurrentVersion->Version != CustomVersion.Version)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FSaveGameFileVersions::DeserializeStruct(TConstArrayView<uint8> Bytes, UScriptStruct* Struct, void* OutData) const
+{
+	FMemoryReaderView MemReader(Bytes);
+	MemReader.SetUEVer(UEVersion);
+	MemReader.SetEngineVer(EngineVersion);
+	MemReader.SetCustomVersions(CustomVersions);
+
+	FObjectAndNameAsStringProxyArchive Archive(MemReader, true);
+	Struct->SerializeItem(Archive, OutData, nullptr);
+
+	return !Archive.IsError();
+}
+
+bool FSaveGameContainer::Write(const FString& Filename, TConstArrayView<FSaveGameChunk> Chunks, ESaveCompressionFormat CompressionFormat,
+	ESaveCompressionLevel CompressionLevel, FSaveGameFileWriteStats* OutStats, TArray<TSharedPtr<const FEncodedSaveGameChunk>>* OutEncodedChunks)
+{
+	FSaveGameFileWriteStats Stats;
+	const double CompressionStartTime = FPlatformTime::Seconds();
+	
+	TArray<FSaveGameChunkEntry> ChunkEntries;
+	ChunkEntries.Reserve(Chunks.Num());
+
+	// Chunks compressed here, shared chunks are written from their own storage
+	TArray<FEncodedSaveGameChunk> CompressedChunks;
+	CompressedChunks.SetNum(Chunks.Num());
+	
+	TArray<const FEncodedSaveGameChunk*> EncodedChunks;
+	EncodedChunks.Reserve(Chunks.Num());
+	
+	{
+		SAVESYSTEM_PHASE_SCOPE(CompressChunks);
+
+		for (int32 Index = 0; Index != Chunks.Num(); ++Index)
+		{
+			const FSaveGameChunk& Chunk = Chunks[Index];
+			const FEncodedSaveGameChunk* EncodedChunk = Chunk.EncodedData.Get();
+			const ESaveCompressionFormat ChunkCompressionFormat = Chunk.bCompress ? CompressionFormat : ESaveCompressionFormat::None;
+
+			if (!EncodedChunk || (EncodedChunk->CompressionFormat == ESaveCompressionFormat::None && ChunkCompressionFormat != ESaveCompressionFormat::None))
+			{
+				const TConstArrayView<uint8> Data = EncodedChunk ? TConstArrayView<uint8>(EncodedChunk->Data) : TConstArrayView<uint8>(Chunk.Data);
+				Compress(Data, ChunkCompressionFormat, CompressionLevel, CompressedChunks[Index]);
+				EncodedChunk = &CompressedChunks[Index];
+			}
+
+			EncodedChunks.Add(EncodedChunk);
+			
+			FSaveGameChunkEntry& Entry = ChunkEntries.AddDefaulted_GetRef();
+			Entry.Type = Chunk.Type;
+			Entry.Name = Chunk.Name;
+			Entry.Size = EncodedChunk->Data.Num();
+			Entry.UncompressedSize = EncodedChunk->UncompressedSize;
+			Entry.CompressionFormat = EncodedChunk->CompressionFormat;
+			Entry.Checksum = FCrc::MemCrc32(EncodedChunk->Data.GetData(), EncodedChunk->Data.Num());
+
+			Stats.UncompressedBytes += Entry.UncompressedSize;
+			Stats.CompressedBytes += Entry.Size;
+		}
+	}
+
+	Stats.CompressionSeconds = static_cast<float>(FPlatformTime::Seconds() - CompressionStartTime);
+	const double WriteStartTime = FPlatformTime::Seconds();
+	SAVESYSTEM_PHASE_SCOPE(WriteSaveFile);
+
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	FSaveGameFileVersions FileVersions;
+	int32 NumChunks = ChunkEntries.Num();
+
+	// Offsets have a fixed size, so the header can be measured before they are known
+	TArray<uint8> Header;
+	auto SerializeHeader = [&]
+	{
+		Header.Reset();
+		FMemoryWriter HeaderWriter(Header);
+		HeaderWriter << FileMagic;
+		HeaderWriter << FileVersion;
+		FileVersions.Serialize(HeaderWriter);
+		HeaderWriter << NumChunks;
+
+		for (FSaveGameChunkEntry& Entry : ChunkEntries)
+		{
+			SerializeEntry(HeaderWriter, Entry, FileVersion);
+		}
+	};
+
+	SerializeHeader();
+
+	int64 Offset = Header.Num();
+	for (FSaveGameChunkEntry& Entry : ChunkEntries)
+	{
+		Entry.Offset = Offset;
+		Offset += Entry.Size;
+	}
+
+	SerializeHeader();
+
+	bool bWritten = false;
+	FString SlotName;
+	if (GetSaveGameSlotName(Filename, SlotName))
+	{
+		// The platform save system takes the file as a whole, the same way UGameplayStatics::SaveGameToSlot hands it over
+		TArray<uint8> FileBytes;
+		FileBytes.Reserve(Offset);
+		FileBytes.Append(Header);
+		for (const FEncodedSaveGameChunk* EncodedChunk : EncodedChunks)
+		{
+			FileBytes.Append(EncodedChunk->Data);
+		}
+
+		bWritten = GetSaveGameSystem().SaveGame(false, *SlotName, 0, FileBytes);
+		UE_CLOG(!bWritten, LogSaveSystem, Error, TEXT("Failed to save slot %s."), *SlotName);
+	}
+	else
+	{
+		const FString TempFilename = Filename + TEXT(".tmp");
+		IFileManager& FileManager = IFileManager::Get();
+		
+		TUniquePtr<FArchive> FileWriter(FileManager.CreateFileWriter(*TempFilename));
+		if (!FileWriter)
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("Failed to open file %s for writing."), *TempFilename);
+			return false;
+		}
+
+		FileWriter->Serialize(Header.GetData(), Header.Num());
+		for (const FEncodedSaveGameChunk* EncodedChunk : EncodedChunks)
+		{
+			FileWriter->Serialize(const_cast<uint8*>(EncodedChunk->Data.GetData()), EncodedChunk->Data.Num());
+		}
+
+		const bool bWriteSucceeded = FileWriter->Close() && !FileWriter->IsError();
+		FileWriter.Reset();
+
+		if (!bWriteSucceeded)
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("Failed to write file %s."), *TempFilename);
+			FileManager.Delete(*TempFilename);
+			return false;
+		}
+
+		bWritten = FileManager.Move(*Filename, *TempFilename, true, true);
+	}
+
+	if (OutEncodedChunks)
+	{
+		OutEncodedChunks->Reset(Chunks.Num());
+		for (int32 Index = 0; Index != Chunks.Num(); ++Index)
+		{
+			if (EncodedChunks[Index] == Chunks[Index].EncodedData.Get())
+			{
+				OutEncodedChunks->Add(Chunks[Index].EncodedData);
+			}
+			else
+			{
+				OutEncodedChunks->Add(MakeShared<FEncodedSaveGameChunk>(MoveTemp(CompressedChunks[Index])));
+			}
+		}
+	}
+	
+	Stats.UncompressedBytes += Header.Num();
+	Stats.CompressedBytes += Header.Num();
+	Stats.WriteSeconds = static_cast<float>(FPlatformTime::Seconds() - WriteStartTime);
+
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+
+	return bWritten;
+}
+
+void FSaveGameContainer::Compress(TConstArrayView<uint8> Data, ESaveCompressionFormat CompressionFormat, ESaveCompressionLevel CompressionLevel, FEncodedSaveGameChunk& OutChunk)
+{
+	OutChunk.UncompressedSize = Data.Num();
+	OutChunk.CompressionFormat = ESaveCompressionFormat::None;
+
+	if (CompressionFormat != ESaveCompressionFormat::None && !Data.IsEmpty())
+	{
+		const FOodleDataCompression::ECompressor Compressor = CompressionFormat == ESaveCompressionFormat::HighRatio
+			? FOodleDataCompression::ECompressor::Leviathan
+			: FOodleDataCompression::ECompressor::Mermaid;
+		
+		FOodleDataCompression::ECompressionLevel Level = FOodleDataCompression::ECompressionLevel::Normal;
+		switch (CompressionLevel)
+		{
+		case ESaveCompressionLevel::HyperFast:
+			Level = FOodleDataCompression::ECompressionLevel::HyperFast1;
+			break;
+		case ESaveCompressionLevel::SuperFast:
+			Level = FOodleDataCompression::ECompressionLevel::SuperFast;
+			break;
+		case ESaveCompressionLevel::VeryFast:
+			Level = FOodleDataCompression::ECompressionLevel::VeryFast;
+			break;
+		case ESaveCompressionLevel::Fast:
+			Level = FOodleDataCompression::ECompressionLevel::Fast;
+			break;
+		case ESaveCompressionLevel::Normal:
+			Level = FOodleDataCompression::ECompressionLevel::Normal;
+			break;
+		case ESaveCompressionLevel::Optimal:
+			Level = FOodleDataCompression::ECompressionLevel::Optimal2;
+			break;
+		}
+
+		OutChunk.Data.SetNumUninitialized(FOodleDataCompression::CompressedBufferSizeNeeded(Data.Num()));
+		const int64 CompressedSize = FOodleDataCompression::Compress(OutChunk.Data.GetData(), OutChunk.Data.Num(), Data.GetData(), Data.Num(), Compressor, Level);
+
+		// Incompressible data is stored as it is
+		if (CompressedSize > 0 && CompressedSize < Data.Num())
+		{
+			OutChunk.Data.SetNum(CompressedSize, false);
+			OutChunk.CompressionFormat = CompressionFormat;
+			return;
+		}
+	}
+
+	OutChunk.Data = Data;
+}
+
+bool FSaveGameContainer::Decompress(const FEncodedSaveGameChunk& Chunk, TArray<uint8>& OutBytes)
+{
+	if (Chunk.CompressionFormat == ESaveCompressionFormat::None)
+	{
+		OutBytes = Chunk.Data;
+		return true;
+	}
+
+	OutBytes.SetNumUninitialized(Chunk.UncompressedSize);
+	return FOodleDataCompression::Decompress(OutBytes.GetData(), OutBytes.Num(), Chunk.Data.GetData(), Chunk.Data.Num());
+}
+
+void FSaveGameContainer::SerializeEntry(FArchive& Ar, FSaveGameChunkEntry& Entry, int32 FileVersion)
+{
+	Ar << Entry.Type;
+	Ar << Entry.Name;
+	Ar << Entry.Offset;
+	Ar << Entry.Size;
+	Ar << Entry.Checksum;
+
+	// Version 1 did not support compression
+	if (FileVersion >= 2)
+	{
+		Ar << Entry.UncompressedSize;
+		Ar << Entry.CompressionFormat;
+	}
+	else
+	{
+		Entry.UncompressedSize = Entry.Size;
+		Entry.CompressionFormat = ESaveCompressionFormat::None;
+	}
+}
+
+void FSaveGameContainer::SerializeStruct(UScriptStruct* Struct, const void* Data, TArray<uint8>& OutBytes)
+{
+	FMemoryWriter MemWriter(OutBytes);
+	FObjectAndNameAsStringProxyArchive Archive(MemWriter, false);
+	Struct->SerializeItem(Archive, const_cast<void*>(Data), nullptr);
+}
+
+bool FSaveGameContainer::FileExists(const FString& Filename)
+{
+	FString SlotName;
+	if (GetSaveGameSlotName(Filename, SlotName))
+	{
+		return GetSaveGameSystem().DoesSaveGameExist(*SlotName, 0);
+	}
+
+	return IFileManager::Get().FileExists(*Filename);
+}
+
+bool FSaveGameContainer::Delete(const FString& Filename)
+{
+	FString SlotName;
+	if (GetSaveGameSlotName(Filename, SlotName))
+	{
+		return GetSaveGameSystem().DeleteGame(false, *SlotName, 0);
+	}
+
+	return IFileManager::Get().Delete(*Filename, false, true, true);
+}
+
+bool FSaveGameContainer::IsStoredInPlace(const FString& Filename)
+{
+	FString SlotName;
+	return !GetSaveGameSlotName(Filename, SlotName) || IFileManager::Get().FileExists(*Filename);
+}
+
+bool FSaveGameContainer::ReadChunkFromFile(const FString& Filename, ESaveGameChunkType Type, TArray<uint8>& OutBytes)
+{
+	FSaveGameContainer Container;
+	if (!Container.Open(Filename))
+	{
+		return false;
+	}
+
+	const FSaveGameChunkEntry* Entry = Container.GetEntries().FindByPredicate([Type](const FSaveGameChunkEntry& Candidate)
+	{
+		return Candidate.Type == Type;
+	});
+
+	return Entry && Container.ReadChunk(*Entry, OutBytes);
+}
+
+bool FSaveGameContainer::ReadChunkFromFile(const FString& Filename, const FSaveGameChunkEntry& Entry, TArray<uint8>& OutBytes)
+{
+	FSaveGameContainer Container;
+	Container.Filename = Filename;
+
+	TUniquePtr<FArchive> FileReader = Container.LoadAndCreateReader();
+	if (!FileReader)
+	{
+		return false;
+	}
+
+	Container.FileSize = FileReader->TotalSize();
+	FileReader.Reset();
+
+	// The checksum of the entry fails the read if the file has been rewritten since
+	return Container.ReadChunk(Entry, OutBytes);
+}
+
+bool FSaveGameContainer::Open(const FString& InFilename)
+{
+	Filename = InFilename;
+	Entries.Reset();
+	bIsContainer = false;
+	
+	TUniquePtr<FArchive> FileReader = LoadAndCreateReader();
+	if (!FileReader)
+	{
+		return false;
+	}
+
+	FileSize = FileReader->TotalSize();
+
+	uint32 FileMagic = 0;
+	int32 FileVersion = 0;
+	*FileReader << FileMagic;
+	if (FileMagic != Magic)
+	{
+		return false;
+	}
+
+	bIsContainer = true;
+	*FileReader << FileVersion;
+
+	if (FileVersion > Version)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("File %s is not a supported save game container."), *Filename);
+		return false;
+	}
+
+	Versions.Serialize(*FileReader);
+
+	int32 NumChunks = 0;
+	*FileReader << NumChunks;
+
+	if (FileReader->IsError() || NumChunks < 0)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to read the table of contents of %s."), *Filename);
+		return false;
+	}
+
+	Entries.SetNum(NumChunks);
+	for (FSaveGameChunkEntry& Entry : Entries)
+	{
+		SerializeEntry(*FileReader, Entry, FileVersion);
+	}
+
+	return !FileReader->IsError();
+}
+
+TUniquePtr<FArchive> FSaveGameContainer::LoadAndCreateReader()
+{
+	FileBytes.Reset();
+	bLoadedFromSaveGameSystem = false;
+
+	// Slots that the platform save system does not keep as plain files can only be loaded as a whole
+	FString SlotName;
+	if (!IsStoredInPlace(Filename) && GetSaveGameSlotName(Filename, SlotName))
+	{
+		if (!GetSaveGameSystem().DoesSaveGameExist(*SlotName, 0) || !GetSaveGameSystem().LoadGame(false, *SlotName, 0, FileBytes))
+		{
+			return nullptr;
+		}
+
+		bLoadedFromSaveGameSystem = true;
+	}
+
+	return CreateReader();
+}
+
+TUniquePtr<FArchive> FSaveGameContainer::CreateReader() const
+{
+	if (bLoadedFromSaveGameSystem)
+	{
+		return MakeUnique<FMemoryReader>(FileBytes);
+	}
+
+	return TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*Filename));
+}
+
+const FSaveGameChunkEntry* FSaveGameContainer::FindEntry(ESaveGameChunkType Type, const FString& Name) const
+{
+	return Entries.FindByPredicate([Type, &Name](const FSaveGameChunkEntry& Entry)
+	{
+		return Entry.Type == Type && Entry.Name == Name;
+	});
+}
+
+bool FSaveGameContainer::ReadEncodedChunk(const FSaveGameChunkEntry& Entry, FEncodedSaveGameChunk& OutChunk, bool bVerifyChecksum) const
+{
+	if (Entry.Offset < 0 || Entry.Size < 0 || Entry.Offset + Entry.Size > FileSize)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Chunk %s of %s lies outside of the file."), *Entry.Name, *Filename);
+		return false;
+	}
+	
+	TUniquePtr<FArchive> FileReader = CreateReader();
+	if (!FileReader)
+	{
+		return false;
+	}
+
+	OutChunk.UncompressedSize = Entry.UncompressedSize;
+	OutChunk.CompressionFormat = Entry.CompressionFormat;
+	OutChunk.Data.SetNumUninitialized(Entry.Size);
+	FileReader->Seek(Entry.Offset);
+	FileReader->Serialize(OutChunk.Data.GetData(), Entry.Size);
+
+	if (FileReader->IsError())
+	{
+		return false;
+	}
+
+	if (bVerifyChecksum && FCrc::MemCrc32(OutChunk.Data.GetData(), OutChunk.Data.Num()) != Entry.Checksum)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Checksum mismatch in chunk %s of %s."), *Entry.Name, *Filename);
+		return false;
+	}
+
+	return true;
+}
+
+bool FSaveGameContainer::ReadChunk(const FSaveGameChunkEntry& Entry, TArray<uint8>& OutBytes, bool bVerifyChecksum) const
+{
+	FEncodedSaveGameChunk EncodedChunk;
+	if (!ReadEncodedChunk(Entry, EncodedChunk, bVerifyChecksum))
+	{
+		return false;
+	}
+
+	if (!Decompress(EncodedChunk, OutBytes))
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to decompress chunk %s of %s."), *Entry.Name, *Filename);
+		return false;
+	}
+
+	return true;
+}
+
+bool FSaveGameContainer::ReadStruct(const FSaveGameChunkEntry& Entry, UScriptStruct* Struct, void* OutData) const
+{
+	TArray<uint8> Bytes;
+	return ReadChunk(Entry, Bytes) && DeserializeStruct(Bytes, Struct, OutData);
+}
+
+bool FSaveGameContainer::Validate(bool bVerifyChecksums) const
+{
+	for (const FSaveGameChunkEntry& Entry : Entries)
+	{
+		if (Entry.Offset < 0 || Entry.Size < 0 || Entry.Offset + Entry.Size > FileSize)
+		{
+			return false;
+		}
+	}
+
+	if (bVerifyChecksums)
+	{
+		FEncodedSaveGameChunk EncodedChunk;
+		for (const FSaveGameChunkEntry& Entry : Entries)
+		{
+			if (!ReadEncodedChunk(Entry, EncodedChunk, true))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,167 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "SaveSystemCommon.h"
+#include "Serialization/CustomVersion.h"
+#include "Misc/EngineVersion.h"
+#include "UObject/ObjectVersion.h"
+
+/** Chunk of a save file in the form it is stored on disk. */
+struct FEncodedSaveGameChunk
+{
+	TArray<uint8> Data;
+	int64 UncompressedSize{0};
+	ESaveCompressionFormat CompressionFormat{ESaveCompressionFormat::None};
+};
+
+/** Sizes and timings of writing a container or a journal record, reported through FSaveGameWriteStats by the subsystem. */
+struct FSaveGameFileWriteStats
+{
+	int64 UncompressedBytes{0};
+	int64 CompressedBytes{0};
+	float CompressionSeconds{0.0f};
+	float WriteSeconds{0.0f};
+};
+
+enum class ESaveGameChunkType : uint8
+{
+	Metadata,
+	Player,
+	AbilitySystem,
+	Level,
+	Thumbnail,
+	JournalBase
+};
+
+struct FSaveGameChunk
+{
+	ESaveGameChunkType Type;
+	FString Name;
+	TArray<uint8> Data;
+
+	// Data that is compressed already, e.g. an encoded image, is stored as it is
+	bool bCompress{true};
+
+	// Already encoded chunk shared with a save game object, used instead of Data when set
+	TSharedPtr<const FEncodedSaveGameChunk> EncodedData;
+};
+
+/** Versions a save file was serialized with, stored in the header of containers and journals. */
+struct FSaveGameFileVersions
+{
+	FPackageFileVersion UEVersion;
+	FEngineVersion EngineVersion;
+	FCustomVersionContainer CustomVersions;
+
+	/** Versions of the running build. */
+	FSaveGameFileVersions();
+
+	void Serialize(FArchive& Ar);
+
+	/** True if structs written with these versions can be written back unchanged by the running build. */
+	bool IsCurrent() const;
+
+	/** Tagged deserialization of a struct that was serialized with these versions. */
+	bool DeserializeStruct(TConstArrayView<uint8> Bytes, UScriptStruct* Struct, void* OutData) const;
+};
+
+struct FSaveGameChunkEntry
+{
+	ESaveGameChunkType Type;
+	FString Name;
+	int64 Offset{0};
+	int64 Size{0};
+	int64 UncompressedSize{0};
+	uint32 Checksum{0};
+	ESaveCompressionFormat CompressionFormat{ESaveCompressionFormat::None};
+};
+
+/**
+ * Save file made of independent chunks, one per level collection plus the player, ability system and metadata sections.
+ * The file starts with a header and a table of contents that stores the offset, size and checksum of every chunk,
+ * so a reader can load or validate single chunks without reading the rest of the file.
+ * Every chunk is compressed on its own, the checksum covers the bytes as they are stored.
+ * With single file slots, the metadata and thumbnail chunks replace the separate json and image files of the slot.
+ *
+ * Layout: Magic | Version | File versions | NumChunks | Entries... | Chunk data...
+ */
+class FSaveGameContainer
+{
+public:
+	static constexpr uint32 Magic = 0x46435353; // SSCF
+	static constexpr int32 Version = 2;
+
+	/**
+	 * Compresses the chunks that are not encoded yet and writes the file. Files of the SaveGames directory are handed to
+	 * the platform save system, like UGameplayStatics::SaveGameToSlot does, other files are written into a temporary
+	 * file that replaces Filename once it is complete. OutEncodedChunks receives the encoded form of every chunk in the order of Chunks,
+	 * so that a later write can reuse the ones that did not change.
+	 */
+	static bool Write(const FString& Filename, TConstArrayView<FSaveGameChunk> Chunks, ESaveCompressionFormat CompressionFormat,
+		ESaveCompressionLevel CompressionLevel, FSaveGameFileWriteStats* OutStats = nullptr,
+		TArray<TSharedPtr<const FEncodedSaveGameChunk>>* OutEncodedChunks = nullptr);
+
+	/** Tagged serialization of a struct, usable from any thread as long as the struct is not modified meanwhile. */
+	static void SerializeStruct(UScriptStruct* Struct, const void* Data, TArray<uint8>& OutBytes);
+
+	static void Compress(TConstArrayView<uint8> Data, ESaveCompressionFormat CompressionFormat, ESaveCompressionLevel CompressionLevel, FEncodedSaveGameChunk& OutChunk);
+	static bool Decompress(const FEncodedSaveGameChunk& Chunk, TArray<uint8>& OutBytes);
+
+	static bool FileExists(const FString& Filename);
+	static bool Delete(const FString& Filename);
+
+	/**
+	 * True if the file can be read in place through the file manager. That holds for files outside of the SaveGames directory
+	 * and for slots that the platform save system keeps as plain files at their path, like the generic save system of desktop platforms.
+	 */
+	static bool IsStoredInPlace(const FString& Filename);
+
+	/** Opens Filename and reads the first chunk of the given type, for readers that need a single section of a save. */
+	static bool ReadChunkFromFile(const FString& Filename, ESaveGameChunkType Type, TArray<uint8>& OutBytes);
+
+	/** Reads a chunk whose entry is known from an earlier Open of the same file, without reading the table of contents again. */
+	static bool ReadChunkFromFile(const FString& Filename, const FSaveGameChunkEntry& Entry, TArray<uint8>& OutBytes);
+
+	/** True if the chunks were serialized with the versions of the running build and can be written back unchanged. */
+	bool HasCurrentVersions() const { return Versions.IsCurrent(); }
+
+	/**
+	 * Reads the header and the table of contents. Chunk data is read on demand, except for slots that are not stored
+	 * in place, which the platform save system only loads as a whole. Files that are no container fail without an error.
+	 */
+	bool Open(const FString& Filename);
+
+	/** True once Open has found the magic of a container, even if the rest of the header could not be read. */
+	bool IsContainer() const { return bIsContainer; }
+
+	const TArray<FSaveGameChunkEntry>& GetEntries() const { return Entries; }
+	const FSaveGameChunkEntry* FindEntry(ESaveGameChunkType Type, const FString& Name = FString()) const;
+
+	/** Reads the chunk as it is stored, without decompressing it. */
+	bool ReadEncodedChunk(const FSaveGameChunkEntry& Entry, FEncodedSaveGameChunk& OutChunk, bool bVerifyChecksum = true) const;
+	bool ReadChunk(const FSaveGameChunkEntry& Entry, TArray<uint8>& OutBytes, bool bVerifyChecksum = true) const;
+	bool ReadStruct(const FSaveGameChunkEntry& Entry, UScriptStruct* Struct, void* OutData) const;
+	bool DeserializeStruct(TConstArrayView<uint8> Bytes, UScriptStruct* Struct, void* OutData) const { return Versions.DeserializeStruct(Bytes, Struct, OutData); }
+
+	/** Checks that every chunk lies inside the file and optionally verifies the chunk checksums. */
+	bool Validate(bool bVerifyChecksums) const;
+
+private:
+	static void SerializeEntry(FArchive& Ar, FSaveGameChunkEntry& Entry, int32 FileVersion);
+
+	TUniquePtr<FArchive> LoadAndCreateReader();
+	TUniquePtr<FArchive> CreateReader() const;
+	
+	FString Filename;
+	int64 FileSize{0};
+
+	// Whole file, if it was loaded through the platform save system
+	TArray<uint8> FileBytes;
+	bool bLoadedFromSaveGameSystem{false};
+	bool bIsContainer{false};
+	TArray<FSaveGameChunkEntry> Entries;
+
+	// A container that has not been opened uses the versions of the running build
+	FSaveGameFileVersions Versions;
+};
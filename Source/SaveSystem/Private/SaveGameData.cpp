@@ -1,5 +1,295 @@
 // Copyright Kyrylo Zaverukha. All Rights Reserved.
 
 #include "SaveGameData.h"
+#include "SaveGameContainer.h"
+
+#include "Hash/CityHash.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SaveGameData)
+
+namespace
+{
+	uint64 HashBytes(const void* Data, int64 Size, uint64 Seed)
+	{
+		return CityHash64WithSeed(static_cast<const char*>(Data), static_cast<uint32>(Size), Seed);
+	}
+
+	uint64 HashName(FName Name, uint64 Seed)
+	{
+		// Display indices tell names apart that only differ in case, like FSaveGameStringTable::StartsWith does
+		const uint32 Ids[] = {Name.GetDisplayIndex().ToUnstableInt(), static_cast<uint32>(Name.GetNumber())};
+		return HashBytes(Ids, sizeof(Ids), Seed);
+	}
+
+	uint64 HashString(const FString& String, uint64 Seed)
+	{
+		return HashBytes(*String, String.Len() * sizeof(TCHAR), Seed);
+	}
+
+	void GetTransformComponents(const FTransform& Transform, double* OutComponents)
+	{
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Translation = Transform.GetTranslation();
+		const FVector Scale = Transform.GetScale3D();
+		const double Components[] = {Rotation.X, Rotation.Y, Rotation.Z, Rotation.W, Translation.X, Translation.Y, Translation.Z, Scale.X, Scale.Y, Scale.Z};
+		FMemory::Memcpy(OutComponents, Components, sizeof(Components));
+	}
+}
+
+bool FSaveGameStringTable::StartsWith(const FSaveGameStringTable& Other) const
+{
+	if (Other.Names.Num() > Names.Num() || Other.ObjectPaths.Num() > ObjectPaths.Num() || Other.PropertySchemas.Num() > PropertySchemas.Num())
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index != Other.PropertySchemas.Num(); ++Index)
+	{
+		if (PropertySchemas[Index].Hash != Other.PropertySchemas[Index].Hash)
+		{
+			return false;
+		}
+	}
+
+	for (int32 Index = 0; Index != Other.Names.Num(); ++Index)
+	{
+		if (!Names[Index].IsEqual(Other.Names[Index], ENameCase::CaseSensitive))
+		{
+			return false;
+		}
+	}
+
+	for (int32 Index = 0; Index != Other.ObjectPaths.Num(); ++Index)
+	{
+		if (!ObjectPaths[Index].Equals(Other.ObjectPaths[Index], ESearchCase::CaseSensitive))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FLevelActorCollection::BuildIndex()
+{
+	NameIndex.Reset();
+	GuidIndex.Reset();
+	NameIndex.Reserve(SavedActors.Num());
+
+	for (int32 Index = 0; Index != SavedActors.Num(); ++Index)
+	{
+		const FActorSaveData& ActorData = SavedActors[Index];
+		NameIndex.Add(ActorData.Name, Index);
+
+		if (ActorData.Guid.IsValid())
+		{
+			GuidIndex.Add(ActorData.Guid, Index);
+		}
+	}
+}
+
+const FActorSaveData* FLevelActorCollection::FindActor(FName Name, const FGuid& Guid) const
+{
+	const int32 Index = FindActorIndex(Name, Guid);
+	return Index != INDEX_NONE ? &SavedActors[Index] : nullptr;
+}
+
+int32 FLevelActorCollection::FindActorIndex(FName Name, const FGuid& Guid) const
+{
+	const int32* Index = Guid.IsValid() ? GuidIndex.Find(Guid) : nullptr;
+
+	if (!Index)
+	{
+		Index = NameIndex.Find(Name);
+	}
+
+	return Index ? *Index : INDEX_NONE;
+}
+
+TConstArrayView<uint8> FLevelActorCollection::GetActorBytes(const FActorSaveData& ActorData) const
+{
+	return TConstArrayView<uint8>(ActorBytes).Slice(ActorData.Offset, ActorData.Size);
+}
+
+FActorSaveData& FLevelActorCollection::AddActor(const FLevelActorCollection& Source, const FActorSaveData& ActorData)
+{
+	FActorSaveData& NewActorData = SavedActors.Add_GetRef(ActorData);
+	NewActorData.Offset = ActorBytes.Num();
+	ActorBytes.Append(Source.GetActorBytes(ActorData));
+
+	return NewActorData;
+}
+
+void FLevelActorCollection::Reset()
+{
+	SavedActors.Reset();
+	ActorBytes.Reset();
+	StringTable.Names.Reset();
+	StringTable.ObjectPaths.Reset();
+	StringTable.PropertySchemas.Reset();
+	ActorFormat = ESavedActorFormat::NameAsString;
+	StringTableBaseSize = 0;
+	NameIndex.Reset();
+	GuidIndex.Reset();
+}
+
+uint64 FLevelActorCollection::ComputeHash() const
+{
+	uint64 Hash = HashBytes(ActorBytes.GetData(), ActorBytes.Num(), static_cast<uint64>(ActorFormat));
+
+	// Every field of a record in one block without padding, so that a record costs a single hash call
+	struct FRecordFields
+	{
+		uint32 Ids[10];
+		double Transform[10];
+	};
+
+	for (const FActorSaveData& ActorData : SavedActors)
+	{
+		FRecordFields Fields;
+		Fields.Ids[0] = ActorData.Name.GetDisplayIndex().ToUnstableInt();
+		Fields.Ids[1] = static_cast<uint32>(ActorData.Name.GetNumber());
+		Fields.Ids[2] = ActorData.Guid.A;
+		Fields.Ids[3] = ActorData.Guid.B;
+		Fields.Ids[4] = ActorData.Guid.C;
+		Fields.Ids[5] = ActorData.Guid.D;
+		Fields.Ids[6] = static_cast<uint32>(ActorData.Offset);
+		Fields.Ids[7] = static_cast<uint32>(ActorData.Size);
+		Fields.Ids[8] = (ActorData.bPropertyPlan ? 1u : 0u) | (ActorData.bUnversioned ? 2u : 0u);
+		Fields.Ids[9] = static_cast<uint32>(ActorData.ByteData.Num());
+		GetTransformComponents(ActorData.Transform, Fields.Transform);
+
+		Hash = HashBytes(&Fields, sizeof(Fields), Hash);
+		Hash = HashBytes(ActorData.ByteData.GetData(), ActorData.ByteData.Num(), Hash);
+	}
+
+	for (FName Name : StringTable.Names)
+	{
+		Hash = HashName(Name, Hash);
+	}
+
+	for (const FString& Path : StringTable.ObjectPaths)
+	{
+		Hash = HashString(Path, Hash);
+	}
+
+	for (const FSavePropertySchema& Schema : StringTable.PropertySchemas)
+	{
+		Hash = HashBytes(&Schema.Hash, sizeof(Schema.Hash), Hash);
+	}
+
+	return Hash;
+}
+
+void FLevelActorCollection::PostSerialize(const FArchive& Ar)
+{
+	if (!Ar.IsLoading())
+	{
+		return;
+	}
+
+	StringTableBaseSize = StringTable.Num();
+
+	for (FActorSaveData& ActorData : SavedActors)
+	{
+		if (!ActorData.ByteData.IsEmpty())
+		{
+			ActorData.Offset = ActorBytes.Num();
+			ActorData.Size = ActorData.ByteData.Num();
+			ActorBytes.Append(ActorData.ByteData);
+			ActorData.ByteData.Empty();
+		}
+	}
+}
+
+uint64 FAbilitySystemSaveData::ComputeHash() const
+{
+	uint64 Hash = 0;
+
+	for (const FGameplayAbilitySaveData& AbilityData : SavedAbilities)
+	{
+		const UPTRINT Fields[] = {reinterpret_cast<UPTRINT>(AbilityData.AbilityClass.Get()), static_cast<UPTRINT>(AbilityData.Level)};
+		Hash = HashBytes(Fields, sizeof(Fields), Hash);
+
+		for (const FGameplayTag& Tag : AbilityData.DynamicTags)
+		{
+			Hash = HashName(Tag.GetTagName(), Hash);
+		}
+	}
+
+	for (const FGameplayEffectSaveData& EffectData : SavedGameplayEffects)
+	{
+		const UPTRINT EffectClass = reinterpret_cast<UPTRINT>(EffectData.EffectClass.Get());
+		Hash = HashBytes(&EffectClass, sizeof(EffectClass), Hash);
+		Hash = HashBytes(&EffectData.Level, sizeof(EffectData.Level), Hash);
+	}
+
+	for (const FAttributeSetSaveData& SetData : SavedAttributeSets)
+	{
+		Hash = HashName(SetData.SetName, Hash);
+		for (FName AttributeName : SetData.AttributeNames)
+		{
+			Hash = HashName(AttributeName, Hash);
+		}
+		Hash = HashBytes(SetData.BaseValues.GetData(), SetData.BaseValues.Num() * sizeof(float), Hash);
+	}
+
+	for (const TPair<FString, FAttributeSaveData>& Pair : SavedAttributes)
+	{
+		Hash = HashString(Pair.Key, Hash);
+		Hash = HashBytes(&Pair.Value.BaseValue, sizeof(Pair.Value.BaseValue), Hash);
+	}
+
+	return Hash;
+}
+
+uint64 FPlayerStateSaveData::ComputeHash() const
+{
+	double Components[10];
+	GetTransformComponents(Transform, Components);
+	return HashBytes(Components, sizeof(Components), bResumeAtTransform ? 1 : 0);
+}
+
+void USaveGameData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	if (!Ar.IsLoading())
+	{
+		return;
+	}
+
+	if (!SavedPlayerAbilities_DEPRECATED.IsEmpty())
+	{
+		AbilitySystemSaveData.SavedAbilities = MoveTemp(SavedPlayerAbilities_DEPRECATED);
+		SavedPlayerAbilities_DEPRECATED.Reset();
+	}
+
+	if (!SavedGameplayEffects_DEPRECATED.IsEmpty())
+	{
+		AbilitySystemSaveData.SavedGameplayEffects = MoveTemp(SavedGameplayEffects_DEPRECATED);
+		SavedGameplayEffects_DEPRECATED.Reset();
+	}
+
+	// Applied by name through the legacy path of FAbilitySystemSaveData::SavedAttributes
+	if (!SavedAttributes_DEPRECATED.IsEmpty())
+	{
+		AbilitySystemSaveData.SavedAttributes = MoveTemp(SavedAttributes_DEPRECATED);
+		SavedAttributes_DEPRECATED.Reset();
+	}
+}
+
+void USaveGameData::Reset()
+{
+	PlayerStateSaveData = FPlayerStateSaveData();
+	AbilitySystemSaveData.SavedAbilities.Reset();
+	AbilitySystemSaveData.SavedGameplayEffects.Reset();
+	AbilitySystemSaveData.SavedAttributeSets.Reset();
+	AbilitySystemSaveData.SavedAttributes.Reset();
+	UnloadedLevelChunks.Reset();
+
+	for (TPair<FString, FLevelActorCollection>& Pair : LevelActorCollections)
+	{
+		Pair.Value.Reset();
+	}
+}
@@ -0,0 +1,440 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveGameJournal.h"
+#include "SaveGameContainer.h"
+#include "SaveSystemLogChannels.h"
+#include "SaveSystemStats.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SaveGameJournal)
+
+bool FSaveGameJournalRecord::IsEmpty() const
+{
+	return !bHasPlayerState && !bHasAbilitySystem && Levels.IsEmpty() && UnloadedLevels.IsEmpty() && RemovedLevels.IsEmpty();
+}
+
+void FSaveGameJournal::Diff(const USaveGameData& Parent, const USaveGameData& SaveGame, FSaveGameJournalRecord& OutRecord)
+{
+	if (!FPlayerStateSaveData::StaticStruct()->CompareScriptStruct(&Parent.PlayerStateSaveData, &SaveGame.PlayerStateSaveData, 0))
+	{
+		OutRecord.bHasPlayerState = true;
+		OutRecord.PlayerStateSaveData = SaveGame.PlayerStateSaveData;
+	}
+
+	if (!FAbilitySystemSaveData::StaticStruct()->CompareScriptStruct(&Parent.AbilitySystemSaveData, &SaveGame.AbilitySystemSaveData, 0))
+	{
+		OutRecord.bHasAbilitySystem = true;
+		OutRecord.AbilitySystemSaveData = SaveGame.AbilitySystemSaveData;
+	}
+
+	for (const TPair<FString, FLevelActorCollection>& Pair : SaveGame.LevelActorCollections)
+	{
+		const FLevelActorCollection& LevelActorCollection = Pair.Value;
+		const FLevelActorCollection* ParentCollection = Parent.LevelActorCollections.Find(Pair.Key);
+
+		// Unchanged bytes only mean unchanged actors if both were written with compatible string tables
+		if (!ParentCollection || ParentCollection->ActorFormat != LevelActorCollection.ActorFormat
+			|| !LevelActorCollection.StringTable.StartsWith(ParentCollection->StringTable))
+		{
+			FSaveGameJournalLevel& Level = OutRecord.Levels.AddDefaulted_GetRef();
+			Level.Key = Pair.Key;
+			Level.bReplace = true;
+			Level.ChangedActors = LevelActorCollection;
+			continue;
+		}
+
+		FSaveGameJournalLevel Level;
+		Level.ChangedActors.StringTable = LevelActorCollection.StringTable;
+		Level.ChangedActors.ActorFormat = LevelActorCollection.ActorFormat;
+
+		for (const FActorSaveData& ActorData : LevelActorCollection.SavedActors)
+		{
+			const FActorSaveData* ParentData = ParentCollection->FindActor(ActorData.Name, ActorData.Guid);
+			if (!ParentData || ParentData->Size != ActorData.Size || ParentData->bPropertyPlan != ActorData.bPropertyPlan
+				|| ParentData->bUnversioned != ActorData.bUnversioned
+				|| !ParentData->Transform.Equals(ActorData.Transform, 0.0)
+				|| FMemory::Memcmp(ParentCollection->GetActorBytes(*ParentData).GetData(), LevelActorCollection.GetActorBytes(ActorData).GetData(), ActorData.Size) != 0)
+			{
+				Level.ChangedActors.AddActor(LevelActorCollection, ActorData);
+			}
+		}
+
+		for (const FActorSaveData& ParentData : ParentCollection->SavedActors)
+		{
+			if (!LevelActorCollection.FindActor(ParentData.Name, ParentData.Guid))
+			{
+				Level.RemovedActors.Add({ParentData.Name, ParentData.Guid});
+			}
+		}
+
+		if (!Level.ChangedActors.SavedActors.IsEmpty() || !Level.RemovedActors.IsEmpty())
+		{
+			Level.Key = Pair.Key;
+			OutRecord.Levels.Add(MoveTemp(Level));
+		}
+	}
+
+	// Chunks of unloaded levels are shared between snapshots until the level streams out again
+	for (const TPair<FString, TSharedRef<const FEncodedSaveGameChunk>>& Pair : SaveGame.UnloadedLevelChunks)
+	{
+		const TSharedRef<const FEncodedSaveGameChunk>* ParentChunk = Parent.UnloadedLevelChunks.Find(Pair.Key);
+		if (ParentChunk && &ParentChunk->Get() == &Pair.Value.Get())
+		{
+			continue;
+		}
+
+		FSaveGameJournalUnloadedLevel& UnloadedLevel = OutRecord.UnloadedLevels.AddDefaulted_GetRef();
+		UnloadedLevel.Key = Pair.Key;
+		UnloadedLevel.Data = Pair.Value->Data;
+		UnloadedLevel.UncompressedSize = Pair.Value->UncompressedSize;
+		UnloadedLevel.CompressionFormat = Pair.Value->CompressionFormat;
+	}
+
+	auto IsRemoved = [&SaveGame](const FString& Key)
+	{
+		return !SaveGame.LevelActorCollections.Contains(Key) && !SaveGame.UnloadedLevelChunks.Contains(Key);
+	};
+
+	for (const TPair<FString, FLevelActorCollection>& Pair : Parent.LevelActorCollections)
+	{
+		if (IsRemoved(Pair.Key))
+		{
+			OutRecord.RemovedLevels.Add(Pair.Key);
+		}
+	}
+
+	for (const TPair<FString, TSharedRef<const FEncodedSaveGameChunk>>& Pair : Parent.UnloadedLevelChunks)
+	{
+		if (IsRemoved(Pair.Key))
+		{
+			OutRecord.RemovedLevels.AddUnique(Pair.Key);
+		}
+	}
+}
+
+bool FSaveGameJournal::Create(const FString& Filename, const FGuid& BaseId)
+{
+	TArray<uint8> Header;
+	FMemoryWriter HeaderWriter(Header);
+
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	FSaveGameFileVersions FileVersions;
+	FGuid FileBaseId = BaseId;
+
+	HeaderWriter << FileMagic;
+	HeaderWriter << FileVersion;
+	FileVersions.Serialize(HeaderWriter);
+	HeaderWriter << FileBaseId;
+
+	const FString TempFilename = Filename + TEXT(".tmp");
+	IFileManager& FileManager = IFileManager::Get();
+
+	TUniquePtr<FArchive> FileWriter(FileManager.CreateFileWriter(*TempFilename));
+	if (!FileWriter)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to open file %s for writing."), *TempFilename);
+		return false;
+	}
+
+	FileWriter->Serialize(Header.GetData(), Header.Num());
+
+	const bool bWriteSucceeded = FileWriter->Close() && !FileWriter->IsError();
+	FileWriter.Reset();
+
+	if (!bWriteSucceeded)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to write file %s."), *TempFilename);
+		FileManager.Delete(*TempFilename);
+		return false;
+	}
+
+	return FileManager.Move(*Filename, *TempFilename, true, true);
+}
+
+bool FSaveGameJournal::CanAppend(const FString& Filename, const FGuid& BaseId, int64 MaxBytes)
+{
+	FSaveGameJournal Journal;
+	return Journal.Open(Filename) && Journal.BaseId == BaseId && (MaxBytes <= 0 || Journal.FileSize < MaxBytes);
+}
+
+bool FSaveGameJournal::Append(const FString& Filename, const FSaveGameJournalRecord& Record, ESaveCompressionFormat CompressionFormat,
+	ESaveCompressionLevel CompressionLevel, FSaveGameFileWriteStats* OutStats)
+{
+	SAVESYSTEM_PHASE_SCOPE(AppendJournal);
+
+	FSaveGameFileWriteStats Stats;
+	const double CompressionStartTime = FPlatformTime::Seconds();
+
+	TArray<uint8> Bytes;
+	FSaveGameContainer::SerializeStruct(FSaveGameJournalRecord::StaticStruct(), &Record, Bytes);
+
+	FEncodedSaveGameChunk EncodedRecord;
+	FSaveGameContainer::Compress(Bytes, CompressionFormat, CompressionLevel, EncodedRecord);
+
+	int64 Size = EncodedRecord.Data.Num();
+	uint32 Checksum = FCrc::MemCrc32(EncodedRecord.Data.GetData(), EncodedRecord.Data.Num());
+
+	Stats.UncompressedBytes = EncodedRecord.UncompressedSize;
+	Stats.CompressedBytes = Size;
+	Stats.CompressionSeconds = static_cast<float>(FPlatformTime::Seconds() - CompressionStartTime);
+	const double WriteStartTime = FPlatformTime::Seconds();
+
+	// A record that is cut off by a crash fails its size or checksum check and ends the replay
+	TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_Append));
+	if (!FileWriter)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to open file %s for appending."), *Filename);
+		return false;
+	}
+
+	*FileWriter << Size;
+	*FileWriter << EncodedRecord.UncompressedSize;
+	*FileWriter << EncodedRecord.CompressionFormat;
+	*FileWriter << Checksum;
+	FileWriter->Serialize(EncodedRecord.Data.GetData(), EncodedRecord.Data.Num());
+
+	if (!FileWriter->Close() || FileWriter->IsError())
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to append to file %s."), *Filename);
+		return false;
+	}
+
+	Stats.WriteSeconds = static_cast<float>(FPlatformTime::Seconds() - WriteStartTime);
+
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+
+	return true;
+}
+
+void FSaveGameJournal::SerializeBaseId(const FGuid& BaseId, TArray<uint8>& OutBytes)
+{
+	FMemoryWriter MemWriter(OutBytes);
+	FGuid Id = BaseId;
+	MemWriter << Id;
+}
+
+bool FSaveGameJournal::DeserializeBaseId(TConstArrayView<uint8> Bytes, FGuid& OutBaseId)
+{
+	FMemoryReaderView MemReader(Bytes);
+	MemReader << OutBaseId;
+	return !MemReader.IsError() && OutBaseId.IsValid();
+}
+
+bool FSaveGameJournal::Open(const FString& InFilename)
+{
+	Filename = InFilename;
+
+	TUniquePtr<FArchive> FileReader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!FileReader)
+	{
+		return false;
+	}
+
+	FileSize = FileReader->TotalSize();
+
+	uint32 FileMagic = 0;
+	int32 FileVersion = 0;
+	*FileReader << FileMagic;
+	*FileReader << FileVersion;
+
+	if (FileMagic != Magic || FileVersion > Version)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("File %s is not a supported save game journal."), *Filename);
+		return false;
+	}
+
+	Versions.Serialize(*FileReader);
+	*FileReader << BaseId;
+
+	RecordsOffset = FileReader->Tell();
+	return !FileReader->IsError();
+}
+
+int32 FSaveGameJournal::Replay(USaveGameData& SaveGame, const FSaveGameContainer& BaseContainer, const TSet<FString>& ResidentLevels) const
+{
+	TUniquePtr<FArchive> FileReader(IFileManager::Get().CreateFileReader(*Filename));
+	if (!FileReader)
+	{
+		return 0;
+	}
+
+	// Levels written by another build have to be converted before they can be written back unchanged
+	const bool bCanKeepEncoded = Versions.IsCurrent();
+
+	// Levels kept encoded from a record of this journal, the other encoded levels come from the base
+	TSet<FString> JournalLevelChunks;
+
+	FileReader->Seek(RecordsOffset);
+	int32 NumRecords = 0;
+
+	while (FileReader->Tell() < FileSize)
+	{
+		int64 Size = 0;
+		uint32 Checksum = 0;
+		FEncodedSaveGameChunk EncodedRecord;
+		*FileReader << Size;
+		*FileReader << EncodedRecord.UncompressedSize;
+		*FileReader << EncodedRecord.CompressionFormat;
+		*FileReader << Checksum;
+
+		if (FileReader->IsError() || Size < 0 || FileReader->Tell() + Size > FileSize)
+		{
+			UE_LOG(LogSaveSystem, Warning, TEXT("Journal %s ends with an incomplete record."), *Filename);
+			break;
+		}
+
+		EncodedRecord.Data.SetNumUninitialized(Size);
+		FileReader->Serialize(EncodedRecord.Data.GetData(), Size);
+
+		TArray<uint8> Bytes;
+		FSaveGameJournalRecord Record;
+		if (FileReader->IsError() || FCrc::MemCrc32(EncodedRecord.Data.GetData(), EncodedRecord.Data.Num()) != Checksum
+			|| !FSaveGameContainer::Decompress(EncodedRecord, Bytes) || !Versions.DeserializeStruct(Bytes, FSaveGameJournalRecord::StaticStruct(), &Record))
+		{
+			UE_LOG(LogSaveSystem, Warning, TEXT("Journal %s has a corrupted record, the records after it are ignored."), *Filename);
+			break;
+		}
+
+		if (Record.bHasPlayerState)
+		{
+			SaveGame.PlayerStateSaveData = MoveTemp(Record.PlayerStateSaveData);
+		}
+
+		if (Record.bHasAbilitySystem)
+		{
+			SaveGame.AbilitySystemSaveData = MoveTemp(Record.AbilitySystemSaveData);
+		}
+
+		for (const FString& Key : Record.RemovedLevels)
+		{
+			SaveGame.LevelActorCollections.Remove(Key);
+			SaveGame.UnloadedLevelChunks.Remove(Key);
+			JournalLevelChunks.Remove(Key);
+		}
+
+		for (FSaveGameJournalUnloadedLevel& UnloadedLevel : Record.UnloadedLevels)
+		{
+			TSharedRef<FEncodedSaveGameChunk> LevelChunk = MakeShared<FEncodedSaveGameChunk>();
+			LevelChunk->Data = MoveTemp(UnloadedLevel.Data);
+			LevelChunk->UncompressedSize = UnloadedLevel.UncompressedSize;
+			LevelChunk->CompressionFormat = UnloadedLevel.CompressionFormat;
+
+			if (bCanKeepEncoded && !ResidentLevels.Contains(UnloadedLevel.Key))
+			{
+				SaveGame.LevelActorCollections.Remove(UnloadedLevel.Key);
+				SaveGame.UnloadedLevelChunks.Add(UnloadedLevel.Key, LevelChunk);
+				JournalLevelChunks.Add(UnloadedLevel.Key);
+				continue;
+			}
+
+			FLevelActorCollection LevelActorCollection;
+			if (FSaveGameContainer::Decompress(*LevelChunk, Bytes) && Versions.DeserializeStruct(Bytes, FLevelActorCollection::StaticStruct(), &LevelActorCollection))
+			{
+				SaveGame.UnloadedLevelChunks.Remove(UnloadedLevel.Key);
+				JournalLevelChunks.Remove(UnloadedLevel.Key);
+				SaveGame.LevelActorCollections.Add(UnloadedLevel.Key, MoveTemp(LevelActorCollection));
+			}
+			else
+			{
+				UE_LOG(LogSaveSystem, Warning, TEXT("Failed to read level %s from journal %s"), *UnloadedLevel.Key, *Filename);
+			}
+		}
+
+		for (const FSaveGameJournalLevel& Level : Record.Levels)
+		{
+			FLevelActorCollection* LevelActorCollection = SaveGame.LevelActorCollections.Find(Level.Key);
+
+			// Kept encoded by the base or an earlier record, each is read with the versions of the file it was written to
+			if (const TSharedRef<const FEncodedSaveGameChunk>* LevelChunk = SaveGame.UnloadedLevelChunks.Find(Level.Key))
+			{
+				if (!Level.bReplace)
+				{
+					LevelActorCollection = &SaveGame.LevelActorCollections.Add(Level.Key);
+					const bool bRead = FSaveGameContainer::Decompress(**LevelChunk, Bytes) && (JournalLevelChunks.Contains(Level.Key)
+						? Versions.DeserializeStruct(Bytes, FLevelActorCollection::StaticStruct(), LevelActorCollection)
+						: BaseContainer.DeserializeStruct(Bytes, FLevelActorCollection::StaticStruct(), LevelActorCollection));
+
+					if (!bRead)
+					{
+						UE_LOG(LogSaveSystem, Warning, TEXT("Failed to read level %s before applying journal %s"), *Level.Key, *Filename);
+					}
+				}
+
+				SaveGame.UnloadedLevelChunks.Remove(Level.Key);
+				JournalLevelChunks.Remove(Level.Key);
+			}
+
+			if (!LevelActorCollection)
+			{
+				LevelActorCollection = &SaveGame.LevelActorCollections.Add(Level.Key);
+			}
+
+			ApplyLevel(Level, *LevelActorCollection);
+		}
+
+		++NumRecords;
+	}
+
+	return NumRecords;
+}
+
+void FSaveGameJournal::ApplyLevel(const FSaveGameJournalLevel& Level, FLevelActorCollection& LevelActorCollection)
+{
+	if (Level.bReplace)
+	{
+		LevelActorCollection = Level.ChangedActors;
+		return;
+	}
+
+	LevelActorCollection.BuildIndex();
+
+	// Records that are removed or replaced, the rest is copied into a new arena without the outdated bytes
+	TBitArray<> SkippedActors(false, LevelActorCollection.SavedActors.Num());
+	for (const FSaveGameJournalActorKey& RemovedActor : Level.RemovedActors)
+	{
+		const int32 Index = LevelActorCollection.FindActorIndex(RemovedActor.Name, RemovedActor.Guid);
+		if (Index != INDEX_NONE)
+		{
+			SkippedActors[Index] = true;
+		}
+	}
+
+	for (const FActorSaveData& ActorData : Level.ChangedActors.SavedActors)
+	{
+		const int32 Index = LevelActorCollection.FindActorIndex(ActorData.Name, ActorData.Guid);
+		if (Index != INDEX_NONE)
+		{
+			SkippedActors[Index] = true;
+		}
+	}
+
+	// The table of the record continues the one of the collection, so it is valid for the kept records as well
+	FLevelActorCollection NewCollection;
+	NewCollection.StringTable = Level.ChangedActors.StringTable;
+	NewCollection.ActorFormat = Level.ChangedActors.ActorFormat;
+	NewCollection.SavedActors.Reserve(LevelActorCollection.SavedActors.Num() + Level.ChangedActors.SavedActors.Num());
+	NewCollection.ActorBytes.Reserve(LevelActorCollection.ActorBytes.Num() + Level.ChangedActors.ActorBytes.Num());
+
+	for (int32 Index = 0; Index != LevelActorCollection.SavedActors.Num(); ++Index)
+	{
+		if (!SkippedActors[Index])
+		{
+			NewCollection.AddActor(LevelActorCollection, LevelActorCollection.SavedActors[Index]);
+		}
+	}
+
+	for (const FActorSaveData& ActorData : Level.ChangedActors.SavedActors)
+	{
+		NewCollection.AddActor(Level.ChangedActors, ActorData);
+	}
+
+	LevelActorCollection = MoveTemp(NewCollection);
+}
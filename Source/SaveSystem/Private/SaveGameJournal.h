@@ -0,0 +1,137 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "SaveGameData.h"
+#include "SaveGameContainer.h"
+#include "SaveGameJournal.generated.h"
+
+USTRUCT()
+struct FSaveGameJournalActorKey
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FName Name;
+
+	UPROPERTY()
+	FGuid Guid;
+};
+
+USTRUCT()
+struct FSaveGameJournalLevel
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Key;
+
+	// The parent snapshot had no decoded state of the level, ChangedActors holds all of its actors
+	UPROPERTY()
+	bool bReplace{false};
+
+	UPROPERTY()
+	FLevelActorCollection ChangedActors;
+
+	UPROPERTY()
+	TArray<FSaveGameJournalActorKey> RemovedActors;
+};
+
+/** Level that streamed out since the parent snapshot, stored as the encoded chunk it is carried in. */
+USTRUCT()
+struct FSaveGameJournalUnloadedLevel
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Key;
+
+	UPROPERTY()
+	TArray<uint8> Data;
+
+	UPROPERTY()
+	int64 UncompressedSize{0};
+
+	UPROPERTY()
+	ESaveCompressionFormat CompressionFormat{ESaveCompressionFormat::None};
+};
+
+/** Sections of a snapshot that differ from its parent snapshot. */
+USTRUCT()
+struct FSaveGameJournalRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	bool bHasPlayerState{false};
+
+	UPROPERTY()
+	FPlayerStateSaveData PlayerStateSaveData;
+
+	UPROPERTY()
+	bool bHasAbilitySystem{false};
+
+	UPROPERTY()
+	FAbilitySystemSaveData AbilitySystemSaveData;
+
+	UPROPERTY()
+	TArray<FSaveGameJournalLevel> Levels;
+
+	UPROPERTY()
+	TArray<FSaveGameJournalUnloadedLevel> UnloadedLevels;
+
+	UPROPERTY()
+	TArray<FString> RemovedLevels;
+
+	bool IsEmpty() const;
+};
+
+/**
+ * Append-only log of the changes made after a full save, so frequent autosaves only write what changed.
+ * The journal belongs to the save file whose JournalBase chunk holds the same id, a journal left over
+ * from an older base is ignored. Loading reads the base and replays every complete record on top of it.
+ *
+ * Layout: Magic | Version | File versions | BaseId | Records...
+ * Record: Size | UncompressedSize | CompressionFormat | Checksum | Data
+ */
+class FSaveGameJournal
+{
+public:
+	static constexpr uint32 Magic = 0x4C4A5353; // SSJL
+	static constexpr int32 Version = 1;
+
+	/** Collects the differences between two snapshots. The collections of both have to be indexed. */
+	static void Diff(const USaveGameData& Parent, const USaveGameData& SaveGame, FSaveGameJournalRecord& OutRecord);
+
+	/** Starts an empty journal for the base with the given id, replacing Filename once it is complete. */
+	static bool Create(const FString& Filename, const FGuid& BaseId);
+
+	/** True if the journal belongs to the base with the given id and is still below MaxBytes. Only the header of the journal is read. */
+	static bool CanAppend(const FString& Filename, const FGuid& BaseId, int64 MaxBytes);
+
+	static bool Append(const FString& Filename, const FSaveGameJournalRecord& Record, ESaveCompressionFormat CompressionFormat,
+		ESaveCompressionLevel CompressionLevel, FSaveGameFileWriteStats* OutStats = nullptr);
+
+	static void SerializeBaseId(const FGuid& BaseId, TArray<uint8>& OutBytes);
+	static bool DeserializeBaseId(TConstArrayView<uint8> Bytes, FGuid& OutBaseId);
+
+	/** Reads the header. Records are read by Replay. */
+	bool Open(const FString& Filename);
+
+	const FGuid& GetBaseId() const { return BaseId; }
+
+	/**
+	 * Applies the records to a save game read from BaseContainer. Levels that are resident or were written by another
+	 * build are decoded, the others stay encoded. A torn record at the end of the file ends the replay.
+	 */
+	int32 Replay(USaveGameData& SaveGame, const FSaveGameContainer& BaseContainer, const TSet<FString>& ResidentLevels) const;
+
+private:
+	static void ApplyLevel(const FSaveGameJournalLevel& Level, FLevelActorCollection& LevelActorCollection);
+
+	FString Filename;
+	int64 FileSize{0};
+	int64 RecordsOffset{0};
+	FGuid BaseId;
+	FSaveGameFileVersions Versions;
+};
@@ -0,0 +1,150 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveGameMetadataIndex.h"
+#include "SaveGameMetadata.h"
+#include "SaveSystemLogChannels.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+FCriticalSection FSaveGameMetadataIndex::FileCriticalSection;
+
+bool FSaveGameMetadataIndex::Load(const FString& Filename)
+{
+	Entries.Reset();
+
+	TArray<uint8> Bytes;
+	{
+		FScopeLock Lock(&FileCriticalSection);
+		if (!FFileHelper::LoadFileToArray(Bytes, *Filename, FILEREAD_Silent))
+		{
+			return false;
+		}
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 FileMagic = 0;
+	int32 FileVersion = 0;
+	FPackageFileVersion FileUEVersion;
+	FEngineVersion FileEngineVersion;
+	Reader << FileMagic;
+	Reader << FileVersion;
+
+	if (FileMagic != Magic || FileVersion != Version)
+	{
+		return false;
+	}
+
+	// The entries hold tagged properties, which are only read back by the build that wrote them
+	Reader << FileUEVersion;
+	Reader << FileEngineVersion;
+
+	if (Reader.IsError() || FileUEVersion != GPackageFileUEVersion || !FileEngineVersion.ExactMatch(FEngineVersion::Current()))
+	{
+		return false;
+	}
+
+	int32 NumEntries = 0;
+	Reader << NumEntries;
+
+	for (int32 Index = 0; Index < NumEntries && !Reader.IsError(); ++Index)
+	{
+		FSaveGameMetadataIndexEntry Entry;
+		Reader << Entry.Key;
+		Reader << Entry.ClassPath;
+		Reader << Entry.Timestamp;
+		Reader << Entry.Data;
+
+		Entries.Add(Entry.Key, MoveTemp(Entry));
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogSaveSystem, Warning, TEXT("Metadata index %s is corrupted and will be rebuilt."), *Filename);
+		Entries.Reset();
+		return false;
+	}
+
+	return true;
+}
+
+bool FSaveGameMetadataIndex::Save(const FString& Filename) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+	FPackageFileVersion FileUEVersion = GPackageFileUEVersion;
+	FEngineVersion FileEngineVersion = FEngineVersion::Current();
+	int32 NumEntries = Entries.Num();
+	Writer << FileMagic;
+	Writer << FileVersion;
+	Writer << FileUEVersion;
+	Writer << FileEngineVersion;
+	Writer << NumEntries;
+
+	for (const TPair<FString, FSaveGameMetadataIndexEntry>& Pair : Entries)
+	{
+		FSaveGameMetadataIndexEntry& Entry = const_cast<FSaveGameMetadataIndexEntry&>(Pair.Value);
+		Writer << Entry.Key;
+		Writer << Entry.ClassPath;
+		Writer << Entry.Timestamp;
+		Writer << Entry.Data;
+	}
+
+	// Readers never see a partially written index
+	const FString TempFilename = Filename + TEXT(".tmp");
+	
+	FScopeLock Lock(&FileCriticalSection);
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TempFilename) || !IFileManager::Get().Move(*Filename, *TempFilename, true, true))
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to write metadata index %s."), *Filename);
+		return false;
+	}
+
+	return true;
+}
+
+void FSaveGameMetadataIndex::UpdateEntry(const FString& Filename, const FSaveGameMetadataIndexEntry& Entry)
+{
+	FScopeLock Lock(&FileCriticalSection);
+
+	FSaveGameMetadataIndex Index;
+	Index.Load(Filename);
+	Index.Entries.Add(Entry.Key, Entry);
+	Index.Save(Filename);
+}
+
+void FSaveGameMetadataIndex::RemoveEntry(const FString& Filename, const FString& Key)
+{
+	FScopeLock Lock(&FileCriticalSection);
+
+	FSaveGameMetadataIndex Index;
+	if (Index.Load(Filename) && Index.Entries.Remove(Key) > 0)
+	{
+		Index.Save(Filename);
+	}
+}
+
+void FSaveGameMetadataIndex::SerializeMetadata(USaveGameMetadata* Metadata, TArray<uint8>& OutBytes)
+{
+	FMemoryWriter MemWriter(OutBytes);
+	FObjectAndNameAsStringProxyArchive Archive(MemWriter, false);
+	Metadata->Serialize(Archive);
+}
+
+bool FSaveGameMetadataIndex::DeserializeMetadata(TConstArrayView<uint8> Bytes, USaveGameMetadata* Metadata)
+{
+	FMemoryReaderView MemReader(Bytes);
+	FObjectAndNameAsStringProxyArchive Archive(MemReader, true);
+	Metadata->Serialize(Archive);
+
+	return !Archive.IsError();
+}
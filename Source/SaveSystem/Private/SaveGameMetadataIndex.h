@@ -0,0 +1,51 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USaveGameMetadata;
+
+struct FSaveGameMetadataIndexEntry
+{
+	// Metadata file relative to the save directory
+	FString Key;
+	FString ClassPath;
+
+	// Modification time of the metadata file this entry was built from
+	FDateTime Timestamp;
+
+	// Tagged properties of the metadata object
+	TArray<uint8> Data;
+};
+
+/**
+ * Single file that holds the metadata of every save slot, so the save menu can list all slots with one read
+ * instead of parsing a json file per slot. Entries are only trusted while the modification time of their
+ * metadata file matches, the json files stay the source of truth.
+ */
+class FSaveGameMetadataIndex
+{
+public:
+	static constexpr uint32 Magic = 0x58444953; // SIDX
+	static constexpr int32 Version = 1;
+
+	TMap<FString, FSaveGameMetadataIndexEntry> Entries;
+
+	/** Fails and leaves the index empty if the file is missing or was written by a different build. */
+	bool Load(const FString& Filename);
+	bool Save(const FString& Filename) const;
+
+	/** Replaces a single entry of the index file. Safe to call from the background writer. */
+	static void UpdateEntry(const FString& Filename, const FSaveGameMetadataIndexEntry& Entry);
+
+	/** Removes the entry of a deleted slot from the index file. */
+	static void RemoveEntry(const FString& Filename, const FString& Key);
+
+	static void SerializeMetadata(USaveGameMetadata* Metadata, TArray<uint8>& OutBytes);
+	static bool DeserializeMetadata(TConstArrayView<uint8> Bytes, USaveGameMetadata* Metadata);
+
+private:
+	// Guards read-modify-write cycles of the index file between the game thread and the writer
+	static FCriticalSection FileCriticalSection;
+};
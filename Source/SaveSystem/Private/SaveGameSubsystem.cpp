@@ -6,34 +6,168 @@
 #include "SaveGameMetadata.h"
 #include "SavableObjectInterface.h"
 #include "SaveSystemLogChannels.h"
+#include "SaveDirtyTracker.h"
+#include "SavableActorRegistry.h"
+#include "SaveGameContainer.h"
+#include "SaveGameJournal.h"
+#include "SaveGameActorArchive.h"
+#include "SavePropertyPlan.h"
+#include "SaveGameMetadataIndex.h"
 #include "ScreenshotTaker.h"
+#include "SaveThumbnailCache.h"
 #include "AutosaveCondition.h"
+#include "AttributeSetLayout.h"
+#include "SaveSystemStats.h"
 
-#include "EngineUtils.h"
 #include "Kismet/GameplayStatics.h"
-#include "Kismet/KismetRenderingLibrary.h"
+#include "Kismet/KismetSystemLibrary.h"
 #include "AbilitySystemComponent.h"
+#include "GameplayEffectAggregator.h"
 #include "GameFramework/PlayerState.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Controller.h"
 #include "GameFramework/Pawn.h"
+#include "Engine/World.h"
 #include "Serialization/ObjectAndNameAsStringProxyArchive.h"
 #include "JsonObjectConverter.h"
 #include "Misc/FileHelper.h"
 #include "HAL/FileManager.h"
 #include "Engine/AssetManager.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Misc/App.h"
+#include "Hash/CityHash.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SaveGameSubsystem)
 
+namespace
+{
+	void SerializeActorSaveData(AActor* Actor, FArchive& InnerArchive, FSaveGameActorArchive::FWriter& Writer, const FSavePropertyPlan* Plan, bool bUnversioned)
+	{
+		FSaveGameActorArchive Archive(InnerArchive, Writer);
+		Archive.ArIsSaveGame = true;
+		if (Plan && bUnversioned)
+		{
+			int32 SchemaIndex = Writer.AddPropertySchema(Plan->GetSchema());
+			Archive << SchemaIndex;
+			Plan->SaveUnversioned(Archive, Actor);
+		}
+		else if (Plan)
+		{
+			Plan->Serialize(Archive, Actor);
+		}
+		else
+		{
+			Actor->Serialize(Archive);
+		}
+	}
+
+	void SerializeActorSaveData(AActor* Actor, FArchive& InnerArchive, FSaveGameActorArchive::FReader& Reader, const FSavePropertyPlan* Plan, bool bUnversioned)
+	{
+		FSaveGameActorArchive Archive(InnerArchive, Reader);
+		Archive.ArIsSaveGame = true;
+		if (Plan && bUnversioned)
+		{
+			int32 SchemaIndex = INDEX_NONE;
+			Archive << SchemaIndex;
+			if (const FSavePropertySchema* Schema = Reader.FindPropertySchema(SchemaIndex))
+			{
+				Plan->LoadUnversioned(Archive, Actor, *Schema, Reader.MatchesPropertySchema(SchemaIndex, Plan->GetSchema()));
+			}
+			else
+			{
+				UE_LOG(LogSaveSystem, Error, TEXT("Saved actor %s references property schema %d, which does not exist."), *Actor->GetName(), SchemaIndex);
+			}
+		}
+		else if (Plan)
+		{
+			Plan->Serialize(Archive, Actor);
+		}
+		else
+		{
+			Actor->Serialize(Archive);
+		}
+	}
+
+	// Saves from before the string table
+	void DeserializeNameAsStringActorSaveData(AActor* Actor, FArchive& InnerArchive)
+	{
+		FObjectAndNameAsStringProxyArchive Archive(InnerArchive, true);
+		Archive.ArIsSaveGame = true;
+		Actor->Serialize(Archive);
+	}
+
+	struct FParallelActorCapture
+	{
+		AActor* Actor;
+		FString LevelKey;
+		FSaveGameActorArchive::FWriter* Writer;
+		const FSavePropertyPlan* Plan;
+		bool bUnversioned;
+		int32 RecordIndex;
+		int32 ContextIndex;
+		int64 Offset;
+		int64 Size;
+	};
+
+	struct FParallelCaptureContext
+	{
+		TArray<uint8> Buffer;
+		int32 Index{INDEX_NONE};
+	};
+
+	void AddFileWriteStats(const FSaveGameFileWriteStats& FileStats, FSaveGameWriteStats& OutStats)
+	{
+		OutStats.UncompressedBytes = FileStats.UncompressedBytes;
+		OutStats.CompressedBytes = FileStats.CompressedBytes;
+		OutStats.CompressionSeconds = FileStats.CompressionSeconds;
+		OutStats.WriteSeconds = FileStats.WriteSeconds;
+	}
+
+	// Saves from before USavableActorRegistry::GetLevelKey stored every level under the name of its ULevel
+	const TCHAR* const LegacyLevelKey = TEXT("PersistentLevel");
+
+	// Directory of the player records of SaveAllPlayers inside the save directory
+	const TCHAR* const PlayersDirectory = TEXT("Players");
+
+	// String tables below this size are continued however much they grew, rewriting their level costs more than they do
+	constexpr int32 StringTableCompactionMinSize = 1024;
+
+	// Keys of the sections hashed for USaveSystemSettings::bSkipUnchangedSaves
+	const TCHAR* const PlayerSectionKey = TEXT("Player");
+	const TCHAR* const AbilitySystemSectionKey = TEXT("AbilitySystem");
+
+	FString GetLevelSectionKey(const FString& LevelKey)
+	{
+		return FString(TEXT("Level:")) + LevelKey;
+	}
+
+	// Unloaded levels are hashed in their encoded form and never serialized by the writer
+	FString GetUnloadedLevelSectionKey(const FString& LevelKey)
+	{
+		return FString(TEXT("UnloadedLevel:")) + LevelKey;
+	}
+}
+
 void USaveGameSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
 
 	Settings = GetDefault<USaveSystemSettings>();
 	AutosaveCounter = 0;
+	WriteCounter = 0;
+	AutosaveRequestTime = 0.0;
+	AutosaveHeadroomWaitStartTime = 0.0;
+	AutosaveCurrentRetryDelay = 0.0f;
+	SmoothedFrameTime = 0.0f;
 
 	if (Settings->bTakeScreenshot)
 	{
 		ScreenshotTaker = NewObject<UScreenshotTaker>();
 		ScreenshotTaker->OnScreenshotTaken.AddDynamic(this, &ThisClass::HandleScreenshotTaken);
+
+		ThumbnailCache = NewObject<USaveThumbnailCache>(this);
+		ThumbnailCache->Configure(Settings->ScreenshotCacheMaxCount, static_cast<int64>(Settings->ScreenshotCacheMaxMegabytes) * 1024 * 1024);
 	}
 
 	if (Settings->bCreateMetadata)
@@ -43,6 +177,9 @@ void USaveGameSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 
 	SetSlotName(Settings->DefaultSaveSlotName);
 
+	WorldInitializedActorsHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &ThisClass::HandleWorldInitializedActors);
+	BindToRegistry(GetSavableActorRegistry());
+
 	if (Settings->bEnableAutosave)
 	{
 		AutosaveCondition = Settings->AutosaveConditionClass->GetDefaultObject<UAutosaveCondition>();
@@ -50,6 +187,15 @@ void USaveGameSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 	}
 }
 
+void USaveGameSubsystem::Deinitialize()
+{
+	FlushSaveGameWrites();
+	FlushPlayerSaves();
+	FWorldDelegates::OnWorldInitializedActors.Remove(WorldInitializedActorsHandle);
+	
+	Super::Deinitialize();
+}
+
 void USaveGameSubsystem::LoadPlayerState()
 {
 	OverrideSpawnTransform();
@@ -62,19 +208,14 @@ void USaveGameSubsystem::SetSlotName(FString NewSlotName)
 		return;
 	}
 
-	if (Settings->bCreateSeparateFolderForSave)
-	{
-		CurrentSlotName = FString::Printf(TEXT("%s/%s"), *NewSlotName, *NewSlotName);
-	}
-	else
-	{
-		CurrentSlotName = NewSlotName;
-	}
+	CurrentSlotName = GetFullSlotName(NewSlotName);
 
 	if (Settings->bCreateMetadata)
 	{
 		MetadataCDO->SlotName = FText::FromString(NewSlotName);
-		CurrentMetadataFilename = FString::Printf(TEXT("%s/%s.json"), *GetSaveDirectory(), *CurrentSlotName);
+		CurrentMetadataFilename = Settings->bSingleFileSlots
+			? GetSaveFilename(CurrentSlotName)
+			: FString::Printf(TEXT("%s/%s.json"), *GetSaveDirectory(), *CurrentSlotName);
 	}
 }
 
@@ -84,317 +225,1808 @@ void USaveGameSubsystem::WriteSaveGame(FString InSlotName)
 	SetSlotName(InSlotName);
 	RequestScreenshot();
 	SaveGameState();
-	
-	OnSaveGameWritten.Broadcast(CurrentSaveGame);
 }
 
 void USaveGameSubsystem::SaveGameState()
 {
-	CurrentSaveGame->LevelActorCollections.Empty();
-	CurrentSaveGame->SavedAttributes.Empty();
-	CurrentSaveGame->SavedGameplayEffects.Empty();
-	CurrentSaveGame->SavedPlayerAbilities.Empty();
-
-	SaveWorldState();
-	SaveAbilitySystemState();
-	SavePlayerState();
+	CaptureGameState();
 	SaveGameToSlot();
 }
 
+void USaveGameSubsystem::CaptureGameState()
+{
+	SAVESYSTEM_PHASE_SCOPE(SaveGameState);
+
+	// The previous snapshot may still be owned by the background writer, so capture into one that it no longer reads
+	PreviousSaveGame = CurrentSaveGame;
+	if (RecycledSaveGame)
+	{
+		CurrentSaveGame = RecycledSaveGame;
+		CurrentSaveGame->Reset();
+		RecycledSaveGame = nullptr;
+	}
+	else
+	{
+		CurrentSaveGame = NewSaveGameDataObject();
+	}
+
+	// Timed here, so that overrides of the sections are included
+	CaptureStats = FSaveGameWriteStats();
+	{
+		SAVESYSTEM_PHASE_SCOPE_SECONDS(SaveWorldState, &CaptureStats.WorldSeconds);
+		SaveWorldState();
+	}
+	{
+		SAVESYSTEM_PHASE_SCOPE_SECONDS(SaveAbilitySystemState, &CaptureStats.AbilitySystemSeconds);
+		SaveAbilitySystemState();
+	}
+	{
+		SAVESYSTEM_PHASE_SCOPE_SECONDS(SavePlayerState, &CaptureStats.PlayerSeconds);
+		SavePlayerState();
+	}
+
+	if (Settings->bSkipUnchangedSaves)
+	{
+		ComputeSectionHashes();
+	}
+
+	PreviousSaveGame = nullptr;
+}
+
+void USaveGameSubsystem::ComputeSectionHashes()
+{
+	SAVESYSTEM_PHASE_SCOPE(HashSections);
+
+	CaptureSectionHashes.Reset();
+	CaptureSectionHashes.Add(PlayerSectionKey, CurrentSaveGame->PlayerStateSaveData.ComputeHash());
+	CaptureSectionHashes.Add(AbilitySystemSectionKey, CurrentSaveGame->AbilitySystemSaveData.ComputeHash());
+
+	TArray<const TPair<FString, FLevelActorCollection>*> Levels;
+	Levels.Reserve(CurrentSaveGame->LevelActorCollections.Num());
+	for (const TPair<FString, FLevelActorCollection>& Pair : CurrentSaveGame->LevelActorCollections)
+	{
+		Levels.Add(&Pair);
+	}
+
+	// Levels hash their whole actor arena, so large levels are hashed side by side
+	TArray<uint64> LevelHashes;
+	LevelHashes.SetNumUninitialized(Levels.Num());
+	ParallelFor(Levels.Num(), [&Levels, &LevelHashes](int32 Index)
+	{
+		LevelHashes[Index] = Levels[Index]->Value.ComputeHash();
+	});
+
+	for (int32 Index = 0; Index != Levels.Num(); ++Index)
+	{
+		CaptureSectionHashes.Add(GetLevelSectionKey(Levels[Index]->Key), LevelHashes[Index]);
+	}
+
+	for (const TPair<FString, TSharedRef<const FEncodedSaveGameChunk>>& Pair : CurrentSaveGame->UnloadedLevelChunks)
+	{
+		const FEncodedSaveGameChunk& Chunk = Pair.Value.Get();
+		CaptureSectionHashes.Add(GetUnloadedLevelSectionKey(Pair.Key), CityHash64WithSeed(reinterpret_cast<const char*>(Chunk.Data.GetData()),
+			static_cast<uint32>(Chunk.Data.Num()), static_cast<uint64>(Chunk.UncompressedSize)));
+	}
+}
+
+bool USaveGameSubsystem::IsCaptureUnchanged() const
+{
+	// A queued snapshot would be written after the last one, so it has to be the newest state on disk first
+	if (!Settings->bSkipUnchangedSaves || InFlightWrite.SaveGame || !PendingWrites.IsEmpty())
+	{
+		return false;
+	}
+
+	return !LastAutosaveSectionHashes.IsEmpty() && CaptureSectionHashes.OrderIndependentCompareEqual(LastAutosaveSectionHashes);
+}
+
 void USaveGameSubsystem::SaveWorldState()
 {
-	for (AActor* Actor : TActorRange<AActor>(GetWorld()))
+	TMap<FObjectKey, ESaveDirtyFlags> DirtyObjects;
+	FSaveDirtyTracker::Get().Consume(DirtyObjects);
+
+	TArray<const FSavableLevelActors*> ResidentLevels;
+	TSet<FString> CapturedLevels;
+	if (USavableActorRegistry* Registry = GetSavableActorRegistry())
+	{
+		for (const TPair<TObjectKey<ULevel>, FSavableLevelActors>& LevelPair : Registry->GetLevels())
+		{
+			ResidentLevels.Add(&LevelPair.Value);
+			if (LevelPair.Value.Level.IsValid())
+			{
+				CapturedLevels.Add(LevelPair.Value.Key);
+			}
+		}
+	}
+
+	CaptureLevelActors(ResidentLevels, PreviousSaveGame, DirtyObjects, CurrentSaveGame->LevelActorCollections);
+
+	// A recycled snapshot still holds the emptied collections of levels that were not captured this time
+	for (auto It = CurrentSaveGame->LevelActorCollections.CreateIterator(); It; ++It)
+	{
+		if (!CapturedLevels.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Unloaded levels are carried over without serializing them again, resident ones were just captured
+	CurrentSaveGame->UnloadedLevelChunks = UnloadedLevelChunks;
+	for (const FString& LevelKey : CapturedLevels)
+	{
+		CurrentSaveGame->UnloadedLevelChunks.Remove(LevelKey);
+	}
+
+	if (PreviousSaveGame)
+	{
+		// Decoded levels of the previous snapshot that are neither loaded nor retained as chunks, e.g. after a map change
+		for (const TPair<FString, FLevelActorCollection>& Pair : PreviousSaveGame->LevelActorCollections)
+		{
+			if (!CurrentSaveGame->LevelActorCollections.Contains(Pair.Key) && !UnloadedLevelChunks.Contains(Pair.Key))
+			{
+				CurrentSaveGame->LevelActorCollections.Add(Pair.Key, Pair.Value);
+			}
+		}
+	}
+
+	// The snapshot becomes the previous one of the next save, which looks records up through the index
+	CaptureStats.NumLevels = CurrentSaveGame->LevelActorCollections.Num();
+	for (TPair<FString, FLevelActorCollection>& Pair : CurrentSaveGame->LevelActorCollections)
+	{
+		Pair.Value.BuildIndex();
+		CaptureStats.NumActors += Pair.Value.SavedActors.Num();
+	}
+}
+
+void USaveGameSubsystem::CaptureLevelActors(TConstArrayView<const FSavableLevelActors*> Levels, const USaveGameData* PreviousSnapshot,
+	const TMap<FObjectKey, ESaveDirtyFlags>& DirtyObjects, TMap<FString, FLevelActorCollection>& OutCollections) const
+{
+	SAVESYSTEM_PHASE_SCOPE(CaptureLevelActors);
+
+	// Actors deferred to the parallel pass, their records are filled after the game thread pass
+	TArray<FParallelActorCapture> ParallelCaptures;
+
+	// One string table per level, shared by the game thread and the parallel pass
+	TArray<TPair<FString, TUniquePtr<FSaveGameActorArchive::FWriter>>> Writers;
+
+	// Game thread time of every level in Writers, the parallel pass is not attributed to levels
+	TArray<double> LevelSeconds;
+
+	// Base size of the continued table of every level in Writers, INDEX_NONE for tables built from scratch
+	TArray<int32> StringTableBaseSizes;
+	
+	for (const FSavableLevelActors* LevelActors : Levels)
 	{
-		if (!IsValid(Actor) || !Actor->Implements<USavableObjectInterface>())
+		if (!LevelActors->Level.IsValid())
 		{
 			continue;
 		}
+
+		const double LevelStartTime = FPlatformTime::Seconds();
+
+		// Levels without savable actors still get a collection, so that loading can tell them apart from unknown levels
+		FLevelActorCollection& LevelActorCollection = OutCollections.FindOrAdd(LevelActors->Key);
+		LevelActorCollection.SavedActors.Reserve(LevelActorCollection.SavedActors.Num() + LevelActors->Actors.Num());
+		
+		const FLevelActorCollection* PreviousCollection = PreviousSnapshot ? PreviousSnapshot->LevelActorCollections.Find(LevelActors->Key) : nullptr;
+		if (PreviousCollection && PreviousCollection->ActorFormat != ESavedActorFormat::StringTable)
+		{
+			// Records of a loaded old save use another format, so they can't be copied
+			PreviousCollection = nullptr;
+		}
+
+		// Entries of changed and removed actors stay in a continued table. Once it has doubled since it was last built
+		// from scratch, every actor of the level is written again so the table only holds the entries still in use.
+		if (PreviousCollection && PreviousCollection->StringTable.Num() > FMath::Max(StringTableCompactionMinSize, 2 * PreviousCollection->StringTableBaseSize))
+		{
+			UE_LOG(LogSaveSystem, Verbose, TEXT("Rebuilding string table of level %s with %d entries"), *LevelActors->Key, PreviousCollection->StringTable.Num());
+			PreviousCollection = nullptr;
+		}
 		
-		FActorSaveData ActorData;
-		ActorData.Name = Actor->GetFName();
-		ActorData.Transform = Actor->GetActorTransform();
+		if (PreviousCollection)
+		{
+			LevelActorCollection.ActorBytes.Reserve(PreviousCollection->ActorBytes.Num());
+		}
+
+		// Reused records keep their indices by continuing the table of the previous snapshot
+		LevelActorCollection.ActorFormat = ESavedActorFormat::StringTable;
+		FSaveGameActorArchive::FWriter& Writer = *Writers.Emplace_GetRef(LevelActors->Key, PreviousCollection
+			? MakeUnique<FSaveGameActorArchive::FWriter>(PreviousCollection->StringTable)
+			: MakeUnique<FSaveGameActorArchive::FWriter>()).Value;
+		StringTableBaseSizes.Add(PreviousCollection ? PreviousCollection->StringTableBaseSize : INDEX_NONE);
 		
-		FMemoryWriter MemWriter(ActorData.ByteData);
-		FObjectAndNameAsStringProxyArchive Archive(MemWriter, true);
-		Archive.ArIsSaveGame = true;
-		Actor->Serialize(Archive);
+		for (const TWeakObjectPtr<AActor>& WeakActor : LevelActors->Actors)
+		{
+			AActor* Actor = WeakActor.Get();
+			if (!IsValid(Actor))
+			{
+				continue;
+			}
+			
+			const FGuid Guid = ISavableObjectInterface::Execute_GetPersistentSaveId(Actor);
+			
+			const ESaveDirtyFlags DirtyFlags = DirtyObjects.FindRef(FObjectKey(Actor));
+			if (PreviousCollection && !EnumHasAnyFlags(DirtyFlags, ESaveDirtyFlags::Data) && ISavableObjectInterface::Execute_UsesSaveDirtyTracking(Actor))
+			{
+				if (const FActorSaveData* PreviousData = PreviousCollection->FindActor(Actor->GetFName(), Guid))
+				{
+					FActorSaveData& ActorData = LevelActorCollection.AddActor(*PreviousCollection, *PreviousData);
+					if (EnumHasAnyFlags(DirtyFlags, ESaveDirtyFlags::Transform))
+					{
+						ActorData.Transform = Actor->GetActorTransform();
+					}
+					continue;
+				}
+			}
+			
+			const int32 RecordIndex = LevelActorCollection.SavedActors.AddDefaulted();
+			FActorSaveData& ActorData = LevelActorCollection.SavedActors[RecordIndex];
+			ActorData.Name = Actor->GetFName();
+			ActorData.Guid = Guid;
+			ActorData.Transform = Actor->GetActorTransform();
+
+			// Plans are looked up here, workers only use them
+			const FSavePropertyPlan* Plan = Settings->bUseSavePropertyPlans && ISavableObjectInterface::Execute_CanUseSavePropertyPlan(Actor)
+				? &FSavePropertyPlan::Get(Actor->GetClass()) : nullptr;
+			ActorData.bPropertyPlan = Plan != nullptr;
+			ActorData.bUnversioned = Plan && Settings->bUnversionedPropertyPlans;
+
+			if (Settings->bParallelActorCapture && ISavableObjectInterface::Execute_CanSerializeOffGameThread(Actor))
+			{
+				ParallelCaptures.Add({Actor, LevelActors->Key, &Writer, Plan, ActorData.bUnversioned, RecordIndex, INDEX_NONE, 0, 0});
+				continue;
+			}
+			
+			// Appended to the arena of the level, the writer only advances its end
+			ActorData.Offset = LevelActorCollection.ActorBytes.Num();
+			FMemoryWriter MemWriter(LevelActorCollection.ActorBytes, false, true);
+			SerializeActorSaveData(Actor, MemWriter, Writer, Plan, ActorData.bUnversioned);
+			ActorData.Size = LevelActorCollection.ActorBytes.Num() - ActorData.Offset;
+		}
+
+		LevelSeconds.Add(FPlatformTime::Seconds() - LevelStartTime);
+	}
+
+	if (ParallelCaptures.Num() >= Settings->ParallelCaptureMinActors)
+	{
+		// Each worker appends to its own scratch buffer, records are sliced out of the buffers afterwards
+		TArray<FParallelCaptureContext> Contexts;
+		ParallelForWithTaskContext(Contexts, ParallelCaptures.Num(), [](int32 ContextIndex, int32 NumContexts)
+		{
+			FParallelCaptureContext Context;
+			Context.Index = ContextIndex;
+			return Context;
+		},
+		[&ParallelCaptures](FParallelCaptureContext& Context, int32 Index)
+		{
+			FParallelActorCapture& Capture = ParallelCaptures[Index];
+			Capture.ContextIndex = Context.Index;
+			Capture.Offset = Context.Buffer.Num();
+			
+			FMemoryWriter MemWriter(Context.Buffer, false, true);
+			SerializeActorSaveData(Capture.Actor, MemWriter, *Capture.Writer, Capture.Plan, Capture.bUnversioned);
+			
+			Capture.Size = Context.Buffer.Num() - Capture.Offset;
+		});
+
+		for (const FParallelActorCapture& Capture : ParallelCaptures)
+		{
+			const TArray<uint8>& Buffer = Contexts[Capture.ContextIndex].Buffer;
+			FLevelActorCollection& LevelActorCollection = OutCollections[Capture.LevelKey];
+			FActorSaveData& ActorData = LevelActorCollection.SavedActors[Capture.RecordIndex];
+			ActorData.Offset = LevelActorCollection.ActorBytes.Num();
+			ActorData.Size = Capture.Size;
+			LevelActorCollection.ActorBytes.Append(Buffer.GetData() + Capture.Offset, Capture.Size);
+		}
+	}
+	else
+	{
+		for (const FParallelActorCapture& Capture : ParallelCaptures)
+		{
+			FLevelActorCollection& LevelActorCollection = OutCollections[Capture.LevelKey];
+			FActorSaveData& ActorData = LevelActorCollection.SavedActors[Capture.RecordIndex];
+			ActorData.Offset = LevelActorCollection.ActorBytes.Num();
+			FMemoryWriter MemWriter(LevelActorCollection.ActorBytes, false, true);
+			SerializeActorSaveData(Capture.Actor, MemWriter, *Capture.Writer, Capture.Plan, Capture.bUnversioned);
+			ActorData.Size = LevelActorCollection.ActorBytes.Num() - ActorData.Offset;
+		}
+	}
 
-		FLevelActorCollection& LevelActorCollection = CurrentSaveGame->LevelActorCollections.FindOrAdd(Actor->GetLevel()->GetName());
-		LevelActorCollection.SavedActors.Add(ActorData);
+	for (int32 Index = 0; Index != Writers.Num(); ++Index)
+	{
+		FLevelActorCollection& LevelActorCollection = OutCollections[Writers[Index].Key];
+		LevelActorCollection.StringTable = Writers[Index].Value->MoveTable();
+		LevelActorCollection.StringTableBaseSize = StringTableBaseSizes[Index] != INDEX_NONE ? StringTableBaseSizes[Index] : LevelActorCollection.StringTable.Num();
+		FSaveSystemStats::Get().RecordLevelCapture(Writers[Index].Key, LevelSeconds[Index], LevelActorCollection.ActorBytes.Num(),
+			LevelActorCollection.SavedActors.Num());
 	}
 }
 
 void USaveGameSubsystem::SaveAbilitySystemState()
 {
-	UAbilitySystemComponent* ASC = FindPlayerAbilitySystemComponent();
+	if (UAbilitySystemComponent* ASC = FindPlayerAbilitySystemComponent())
+	{
+		CaptureAbilitySystem(ASC, CurrentSaveGame->AbilitySystemSaveData);
+	}
+}
+
+void USaveGameSubsystem::CaptureAbilitySystem(UAbilitySystemComponent* ASC, FAbilitySystemSaveData& OutData) const
+{
+	const TArray<FGameplayAbilitySpec>& AbilitySpecs = ASC->GetActivatableAbilities();
+	for (const FGameplayAbilitySpec& Spec : AbilitySpecs)
+	{
+		UGameplayAbility* Ability = Spec.Ability;
+
+		if (!Ability->Implements<USavableObjectInterface>())
+		{
+			continue;
+		}
+
+		FGameplayAbilitySaveData AbilityData;
+		AbilityData.AbilityClass = Ability->GetClass();
+		AbilityData.Level = Ability->GetAbilityLevel();
+		AbilityData.DynamicTags = Spec.DynamicAbilityTags;
+
+		OutData.SavedAbilities.Add(AbilityData);
+	}
+
+	TArray<FGameplayEffectSpec> EffectSpecs;
+	ASC->GetAllActiveGameplayEffectSpecs(EffectSpecs);
+
+	for (const FGameplayEffectSpec& Spec : EffectSpecs)
+	{
+		const UGameplayEffect* Effect = Spec.Def;
+
+		if (!Effect->Implements<USavableObjectInterface>())
+		{
+			continue;
+		}
+
+		FGameplayEffectSaveData EffectData;
+		EffectData.Level = Spec.GetLevel();
+		EffectData.EffectClass = Effect->GetClass();
+
+		OutData.SavedGameplayEffects.Add(EffectData);
+	}
+
+	const TArray<UAttributeSet*>& AttrSets = ASC->GetSpawnedAttributes();
+	OutData.SavedAttributeSets.Reserve(AttrSets.Num());
+	for (UAttributeSet* AttrSet : AttrSets)
+	{
+		const FAttributeSetLayout& Layout = FAttributeSetLayout::Get(AttrSet->GetClass());
+		Layout.Save(AttrSet, OutData.SavedAttributeSets.AddDefaulted_GetRef());
+	}
+}
+
+void USaveGameSubsystem::SavePlayerState()
+{
+	APawn* Pawn = GetPlayerState()->GetPawn();
+	if (!ensure(Pawn))
+	{
+		return;
+	}
+	
+	CurrentSaveGame->PlayerStateSaveData.Transform = Pawn->GetTransform();
+
+	// Temp
+	CurrentSaveGame->PlayerStateSaveData.bResumeAtTransform = true;
+}
+
+void USaveGameSubsystem::HandleAutosave()
+{
+	if (!Settings->bEnableAutosave)
+	{
+		return;
+	}
+	
+	AutosaveRequestTime = FPlatformTime::Seconds();
+	AutosaveHeadroomWaitStartTime = 0.0;
+	AutosaveCurrentRetryDelay = Settings->AutosaveRetryDelay;
+	SmoothedFrameTime = FApp::GetDeltaTime();
+
+	TryStartAutosave();
+}
+
+void USaveGameSubsystem::TryStartAutosave()
+{
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	
+	if (!AutosaveCondition->IsAutosavePossible())
+	{
+		// Check again later instead of blocking the game thread until the condition changes
+		AutosaveHeadroomWaitStartTime = 0.0;
+		TimerManager.SetTimer(AutosaveTimer, this, &ThisClass::TryStartAutosave, FMath::Max(AutosaveCurrentRetryDelay, UE_KINDA_SMALL_NUMBER));
+		AutosaveCurrentRetryDelay = FMath::Min(AutosaveCurrentRetryDelay * Settings->AutosaveRetryBackoff, Settings->AutosaveMaxRetryDelay);
+		return;
+	}
+
+	if (Settings->AutosaveFrameTimeBudget > 0.0f)
+	{
+		// Exponential moving average of the frame time, sampled on every frame while waiting for headroom
+		SmoothedFrameTime = FMath::Lerp(SmoothedFrameTime, static_cast<float>(FApp::GetDeltaTime()), 0.25f);
+		
+		const double Now = FPlatformTime::Seconds();
+		if (AutosaveHeadroomWaitStartTime == 0.0)
+		{
+			AutosaveHeadroomWaitStartTime = Now;
+		}
+
+		const bool bHasHeadroom = SmoothedFrameTime * 1000.0f <= Settings->AutosaveFrameTimeBudget;
+		const bool bWaitedTooLong = Now - AutosaveHeadroomWaitStartTime >= Settings->AutosaveMaxHeadroomDeferral;
+		
+		if (!bHasHeadroom && !bWaitedTooLong)
+		{
+			AutosaveTimer = TimerManager.SetTimerForNextTick(this, &ThisClass::TryStartAutosave);
+			return;
+		}
+	}
+
+	PerformAutosave();
+}
+
+void USaveGameSubsystem::PerformAutosave()
+{
+	const float DeferredSeconds = static_cast<float>(FPlatformTime::Seconds() - AutosaveRequestTime);
+	UE_LOG(LogSaveSystem, Verbose, TEXT("Autosave deferred by %.3f s"), DeferredSeconds);
+	
+	OnAutosaveStarted.Broadcast(CurrentSaveGame);
+	OnAutosaveDeferred.Broadcast(DeferredSeconds);
+
+	CaptureGameState();
+
+	// Writing the same state again would only rotate an older autosave out
+	if (IsCaptureUnchanged())
+	{
+		UE_LOG(LogSaveSystem, Verbose, TEXT("Skipped autosave, nothing changed since the last autosave"));
+	}
+	else
+	{
+		SetSlotName(GetAutosaveSlotName());
+		RequestScreenshot();
+		SaveGameToSlot(true);
+	}
+
+	OnAutosaveFinished.Broadcast(CurrentSaveGame);
+
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	TimerManager.ClearTimer(AutosaveTimer);
+	TimerManager.SetTimer(AutosaveTimer, this, &ThisClass::HandleAutosave, Settings->AutosavePeriod);
+}
+
+void USaveGameSubsystem::SaveGameToSlot(bool bAutosave)
+{
+	FSaveGameWriteRequest Request;
+	Request.SaveGame = CurrentSaveGame;
+	Request.bAutosave = bAutosave;
+	Request.SlotName = CurrentSlotName;
+	Request.SaveFilename = GetSaveFilename(CurrentSlotName);
+	Request.CompressionFormat = Settings->SaveCompressionFormat;
+	Request.CompressionLevel = Settings->SaveCompressionLevel;
+	Request.WriteId = ++WriteCounter;
+	Request.bSingleFile = Settings->bSingleFileSlots;
+	Request.Thumbnail = MoveTemp(PendingThumbnail);
+
+	if (IsJournalSlot(CurrentSlotName))
+	{
+		Request.bJournal = true;
+		Request.JournalFilename = GetJournalFilename(CurrentSlotName);
+		Request.JournalMaxBytes = static_cast<int64>(Settings->AutosaveJournalMaxKilobytes) * 1024;
+	}
+
+	if (Settings->bCreateMetadata)
+	{
+		SAVESYSTEM_PHASE_SCOPE_SECONDS(SaveMetadata, &CaptureStats.MetadataSeconds);
+
+		if (SerializeMetadata(Request.MetadataJson))
+		{
+			Request.MetadataFilename = CurrentMetadataFilename;
+			Request.MetadataIndexFilename = GetMetadataIndexFilename();
+
+			// The writer only adds the timestamp of the metadata file once it is written
+			TSharedRef<FSaveGameMetadataIndexEntry> IndexEntry = MakeShared<FSaveGameMetadataIndexEntry>();
+			IndexEntry->Key = CurrentMetadataFilename;
+			FPaths::MakePathRelativeTo(IndexEntry->Key, *(GetSaveDirectory() / TEXT("")));
+			IndexEntry->ClassPath = MetadataCDO->GetClass()->GetPathName();
+			FSaveGameMetadataIndex::SerializeMetadata(MetadataCDO, IndexEntry->Data);
+			Request.MetadataIndexEntry = IndexEntry;
+		}
+	}
+
+	if (Settings->bSkipUnchangedSaves)
+	{
+		Request.SectionHashes = CaptureSectionHashes;
+		for (const TPair<FString, uint64>& Pair : CaptureSectionHashes)
+		{
+			const TPair<uint64, TSharedPtr<const FEncodedSaveGameChunk>>* Written = WrittenSections.Find(Pair.Key);
+			if (Written && Written->Key == Pair.Value)
+			{
+				Request.ReusedSections.Add(Pair.Key, Written->Value);
+			}
+		}
+	}
+
+	CaptureStats.CaptureSeconds = CaptureStats.WorldSeconds + CaptureStats.AbilitySystemSeconds + CaptureStats.PlayerSeconds + CaptureStats.MetadataSeconds;
+	Request.Stats = CaptureStats;
+	Request.CaptureEndTime = FPlatformTime::Seconds();
+
+	// Coalesce with a snapshot of the same slot that is still waiting for the writer
+	const int32 PendingIndex = PendingWrites.IndexOfByPredicate([&Request](const FSaveGameWriteRequest& Pending)
+	{
+		return Pending.SlotName == Request.SlotName;
+	});
+
+	if (PendingIndex != INDEX_NONE)
+	{
+		UE_LOG(LogSaveSystem, Verbose, TEXT("Dropped outdated snapshot for slot %s"), *Request.SlotName);
+		PendingWrites[PendingIndex] = MoveTemp(Request);
+	}
+	else
+	{
+		PendingWrites.Add(MoveTemp(Request));
+	}
+
+	StartNextWrite();
+}
+
+void USaveGameSubsystem::StartNextWrite()
+{
+	if (InFlightWrite.SaveGame || PendingWrites.IsEmpty())
+	{
+		return;
+	}
+
+	// The screenshot arrives a frame later, HandleScreenshotTaken starts the write once it is encoded.
+	// Each slot has at most one pending snapshot, so a slot that still waits for its screenshot lets the others go first.
+	const double Now = FPlatformTime::Seconds();
+	double NextTimeout = TNumericLimits<double>::Max();
+	int32 NextIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < PendingWrites.Num(); ++Index)
+	{
+		FSaveGameWriteRequest& Pending = PendingWrites[Index];
+		if (Pending.Thumbnail.IsValid() && !Pending.Thumbnail.IsReady())
+		{
+			const double Timeout = Pending.CaptureEndTime + Settings->ScreenshotTimeoutSeconds;
+			if (Now < Timeout)
+			{
+				NextTimeout = FMath::Min(NextTimeout, Timeout);
+				continue;
+			}
+
+			UE_LOG(LogSaveSystem, Verbose, TEXT("Writing slot %s without its screenshot"), *Pending.SlotName);
+			Pending.Thumbnail = TSharedFuture<TArray64<uint8>>();
+		}
+
+		NextIndex = Index;
+		break;
+	}
+
+	if (NextIndex == INDEX_NONE)
+	{
+		// Retry once the earliest screenshot wait runs out, in case the screenshot never arrives
+		if (!ScreenshotTimeoutTickerHandle.IsValid())
+		{
+			ScreenshotTimeoutTickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+				FTickerDelegate::CreateUObject(this, &ThisClass::HandleScreenshotTimeout), static_cast<float>(NextTimeout - Now));
+		}
+		return;
+	}
+
+	InFlightWrite = PendingWrites[NextIndex];
+	PendingWrites.RemoveAt(NextIndex);
+
+	if (InFlightWrite.bJournal)
+	{
+		// Writes run one after another, so the journal holds the state of the previous journaled snapshot by then
+		InFlightWrite.JournalParent = LastJournaledSaveGame;
+		InFlightWrite.JournalBaseId = JournalBaseId;
+		LastJournaledSaveGame = InFlightWrite.SaveGame;
+	}
+
+	// The writer adds its own timings to the ones of the capture
+	InFlightWriteStats = MakeShared<FSaveGameWriteStats>(InFlightWrite.Stats);
+	InFlightWriteStats->QueueSeconds = static_cast<float>(FPlatformTime::Seconds() - InFlightWrite.CaptureEndTime);
+	InFlightWriteSections = MakeShared<TMap<FString, TSharedPtr<const FEncodedSaveGameChunk>>>();
+	InFlightJournalBaseId = MakeShared<FGuid>();
+
+	TWeakObjectPtr<ThisClass> WeakThis(this);
+	WriteTask = Async(EAsyncExecution::ThreadPool, [WeakThis, Request = InFlightWrite, Stats = InFlightWriteStats, Sections = InFlightWriteSections,
+		NewJournalBaseId = InFlightJournalBaseId]
+	{
+		const bool bSuccess = WriteSaveGameToDisk(Request, *Stats, *Sections, *NewJournalBaseId);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, WriteId = Request.WriteId, bSuccess]
+		{
+			if (ThisClass* This = WeakThis.Get())
+			{
+				This->HandleWriteFinished(WriteId, bSuccess);
+			}
+		});
+
+		return bSuccess;
+	});
+}
+
+void USaveGameSubsystem::HandleWriteFinished(uint32 WriteId, bool bSuccess)
+{
+	// The write may have already been completed by FlushSaveGameWrites
+	if (!InFlightWrite.SaveGame || InFlightWrite.WriteId != WriteId)
+	{
+		return;
+	}
+
+	USaveGameData* WrittenSaveGame = InFlightWrite.SaveGame;
+	const FString SlotName = InFlightWrite.SlotName;
+	const FString SaveFilename = InFlightWrite.SaveFilename;
+	const bool bSingleFile = InFlightWrite.bSingleFile;
+	const bool bJournal = InFlightWrite.bJournal;
+	const bool bAutosave = InFlightWrite.bAutosave;
+	const TMap<FString, uint64> SectionHashes = MoveTemp(InFlightWrite.SectionHashes);
+	InFlightWrite = FSaveGameWriteRequest();
+
+	if (bSuccess)
+	{
+		// Without a journal next to the base, the next autosave writes a full save again
+		if (bJournal)
+		{
+			JournalBaseId = *InFlightJournalBaseId;
+			if (!JournalBaseId.IsValid())
+			{
+				LastJournaledSaveGame = nullptr;
+			}
+		}
+
+		LastWriteStats = *InFlightWriteStats;
+		UE_LOG(LogSaveSystem, Display, TEXT("Wrote SaveGameData to slot %s (%lld bytes, %lld uncompressed, capture %.3f s, serialize %.3f s, compression %.3f s, write %.3f s)"),
+			*SlotName, LastWriteStats.CompressedBytes, LastWriteStats.UncompressedBytes, LastWriteStats.CaptureSeconds, LastWriteStats.SerializeSeconds,
+			LastWriteStats.CompressionSeconds, LastWriteStats.WriteSeconds);
+
+		if (!SectionHashes.IsEmpty())
+		{
+			if (bAutosave)
+			{
+				LastAutosaveSectionHashes = SectionHashes;
+			}
+
+			// Sections that are no longer part of the save can not be reused
+			for (auto It = WrittenSections.CreateIterator(); It; ++It)
+			{
+				if (!SectionHashes.Contains(It->Key))
+				{
+					It.RemoveCurrent();
+				}
+			}
+
+			// Journaled writes only append a diff and leave the encoded sections of the base as they are
+			for (const TPair<FString, TSharedPtr<const FEncodedSaveGameChunk>>& Pair : *InFlightWriteSections)
+			{
+				WrittenSections.Add(Pair.Key, MakeTuple(SectionHashes[Pair.Key], Pair.Value));
+			}
+		}
+		
+		// The thumbnail of a single file slot is cached under its save file, and the write moved its chunk
+		if (bSingleFile)
+		{
+			FString MetadataKey = SaveFilename;
+			FPaths::MakePathRelativeTo(MetadataKey, *(GetSaveDirectory() / TEXT("")));
+			if (FCachedSaveGameMetadata* CachedMetadata = MetadataCache.Find(MetadataKey))
+			{
+				CachedMetadata->ThumbnailEntry.Reset();
+			}
+
+			if (ThumbnailCache)
+			{
+				ThumbnailCache->Invalidate(SaveFilename);
+			}
+		}
+		
+		OnSaveGameWritten.Broadcast(WrittenSaveGame);
+		OnSaveGameWriteStats.Broadcast(SlotName, LastWriteStats);
+	}
+	else
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to write SaveGameData to slot %s"), *SlotName);
+
+		// The journal may miss this snapshot or end with a torn record, so the next write starts a new base
+		if (bJournal)
+		{
+			LastJournaledSaveGame = nullptr;
+			JournalBaseId.Invalidate();
+		}
+
+		// Whatever is on disk now, the next autosave has to write
+		LastAutosaveSectionHashes.Reset();
+	}
+
+	// The writer is done with the snapshot, so a later capture can reuse the memory of its containers
+	if (!IsSnapshotInUse(WrittenSaveGame))
+	{
+		RecycledSaveGame = WrittenSaveGame;
+	}
+
+	InFlightWriteStats.Reset();
+	InFlightWriteSections.Reset();
+	InFlightJournalBaseId.Reset();
+	StartNextWrite();
+}
+
+bool USaveGameSubsystem::IsSnapshotInUse(const USaveGameData* SaveGame) const
+{
+	if (SaveGame == CurrentSaveGame || SaveGame == PreviousSaveGame || SaveGame == LastJournaledSaveGame)
+	{
+		return true;
+	}
+
+	if (InFlightWrite.SaveGame == SaveGame || InFlightWrite.JournalParent == SaveGame)
+	{
+		return true;
+	}
+
+	return PendingWrites.ContainsByPredicate([SaveGame](const FSaveGameWriteRequest& Pending)
+	{
+		return Pending.SaveGame == SaveGame || Pending.JournalParent == SaveGame;
+	});
+}
+
+void USaveGameSubsystem::FlushSaveGameWrites()
+{
+	// Screenshots are captured on the game thread, which is blocked until the writes are done
+	for (FSaveGameWriteRequest& Pending : PendingWrites)
+	{
+		if (Pending.Thumbnail.IsValid() && !Pending.Thumbnail.IsReady())
+		{
+			UE_LOG(LogSaveSystem, Verbose, TEXT("Writing slot %s without its screenshot"), *Pending.SlotName);
+			Pending.Thumbnail = TSharedFuture<TArray64<uint8>>();
+		}
+	}
+
+	StartNextWrite();
+	
+	while (InFlightWrite.SaveGame)
+	{
+		WriteTask.Wait();
+		HandleWriteFinished(InFlightWrite.WriteId, WriteTask.Get());
+	}
+
+	if (ScreenshotTimeoutTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(ScreenshotTimeoutTickerHandle);
+		ScreenshotTimeoutTickerHandle.Reset();
+	}
+}
+
+bool USaveGameSubsystem::WriteSaveGameToDisk(const FSaveGameWriteRequest& Request, FSaveGameWriteStats& OutStats,
+	TMap<FString, TSharedPtr<const FEncodedSaveGameChunk>>& OutSections, FGuid& OutJournalBaseId)
+{
+	if (!Request.bSingleFile && !Request.MetadataFilename.IsEmpty())
+	{
+		if (FFileHelper::SaveStringToFile(Request.MetadataJson, *Request.MetadataFilename))
+		{
+			FSaveGameMetadataIndexEntry IndexEntry = *Request.MetadataIndexEntry;
+			IndexEntry.Timestamp = IFileManager::Get().GetTimeStamp(*Request.MetadataFilename);
+			FSaveGameMetadataIndex::UpdateEntry(Request.MetadataIndexFilename, IndexEntry);
+		}
+		else
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("Failed to save json string to file %s."), *Request.MetadataFilename);
+		}
+	}
+
+	const USaveGameData* SaveGame = Request.SaveGame;
+
+	// The base id is known from the write of the base, so appending never reads the base file
+	if (Request.bJournal && Request.JournalParent && Request.JournalBaseId.IsValid()
+		&& FSaveGameJournal::CanAppend(Request.JournalFilename, Request.JournalBaseId, Request.JournalMaxBytes))
+	{
+		OutJournalBaseId = Request.JournalBaseId;
+
+		FSaveGameJournalRecord Record;
+		{
+			SAVESYSTEM_PHASE_SCOPE_SECONDS(SerializeSaveGame, &OutStats.SerializeSeconds);
+			FSaveGameJournal::Diff(*Request.JournalParent, *SaveGame, Record);
+		}
+		if (Record.IsEmpty())
+		{
+			return true;
+		}
+
+		FSaveGameFileWriteStats FileStats;
+		const bool bAppended = FSaveGameJournal::Append(Request.JournalFilename, Record, Request.CompressionFormat, Request.CompressionLevel, &FileStats);
+		AddFileWriteStats(FileStats, OutStats);
+		return bAppended;
+	}
+	
+	TArray<FSaveGameChunk> Chunks;
+	Chunks.Reserve(SaveGame->LevelActorCollections.Num() + 3);
+
+	// Section key of every chunk, empty for chunks that are not hashed
+	TArray<FString> ChunkSections;
+	ChunkSections.Reserve(SaveGame->LevelActorCollections.Num() + 3);
+
+	// Sections that did not change since an earlier write are written from its encoded chunk
+	auto ReuseSection = [&Request, &OutStats](FSaveGameChunk& Chunk, const FString& SectionKey)
+	{
+		const TSharedPtr<const FEncodedSaveGameChunk>* Reused = Request.ReusedSections.Find(SectionKey);
+		if (!Reused)
+		{
+			return false;
+		}
+
+		Chunk.EncodedData = *Reused;
+		++OutStats.NumReusedSections;
+		return true;
+	};
+
+	if (!Request.MetadataJson.IsEmpty())
+	{
+		FTCHARToUTF8 MetadataUtf8(*Request.MetadataJson);
+		FSaveGameChunk& MetadataChunk = Chunks.Add_GetRef({ESaveGameChunkType::Metadata});
+		MetadataChunk.Data.Append(reinterpret_cast<const uint8*>(MetadataUtf8.Get()), MetadataUtf8.Length());
+		ChunkSections.AddDefaulted();
+	}
+
+	{
+		SAVESYSTEM_PHASE_SCOPE_SECONDS(SerializeSaveGame, &OutStats.SerializeSeconds);
+
+		FSaveGameChunk& PlayerChunk = Chunks.Add_GetRef({ESaveGameChunkType::Player});
+		ChunkSections.Add(PlayerSectionKey);
+		if (!ReuseSection(PlayerChunk, ChunkSections.Last()))
+		{
+			FSaveGameContainer::SerializeStruct(FPlayerStateSaveData::StaticStruct(), &SaveGame->PlayerStateSaveData, PlayerChunk.Data);
+		}
+
+		FSaveGameChunk& AbilitySystemChunk = Chunks.Add_GetRef({ESaveGameChunkType::AbilitySystem});
+		ChunkSections.Add(AbilitySystemSectionKey);
+		if (!ReuseSection(AbilitySystemChunk, ChunkSections.Last()))
+		{
+			FSaveGameContainer::SerializeStruct(FAbilitySystemSaveData::StaticStruct(), &SaveGame->AbilitySystemSaveData, AbilitySystemChunk.Data);
+		}
+
+		for (const TPair<FString, FLevelActorCollection>& Pair : SaveGame->LevelActorCollections)
+		{
+			FSaveGameChunk& LevelChunk = Chunks.Add_GetRef({ESaveGameChunkType::Level, Pair.Key});
+			ChunkSections.Add(GetLevelSectionKey(Pair.Key));
+			if (!ReuseSection(LevelChunk, ChunkSections.Last()))
+			{
+				FSaveGameContainer::SerializeStruct(FLevelActorCollection::StaticStruct(), &Pair.Value, LevelChunk.Data);
+			}
+		}
+	}
+
+	// Already encoded, so there is nothing to keep for them
+	for (const TPair<FString, TSharedRef<const FEncodedSaveGameChunk>>& Pair : SaveGame->UnloadedLevelChunks)
+	{
+		// A stale chunk of a resident level would shadow its captured collection when the save is loaded
+		if (SaveGame->LevelActorCollections.Contains(Pair.Key))
+		{
+			continue;
+		}
+
+		FSaveGameChunk& LevelChunk = Chunks.Add_GetRef({ESaveGameChunkType::Level, Pair.Key});
+		LevelChunk.EncodedData = Pair.Value;
+		ChunkSections.AddDefaulted();
+	}
+
+	if (Request.Thumbnail.IsValid() && !Request.Thumbnail.Get().IsEmpty())
+	{
+		FSaveGameChunk& ThumbnailChunk = Chunks.Add_GetRef({ESaveGameChunkType::Thumbnail});
+		ThumbnailChunk.Data.Append(Request.Thumbnail.Get().GetData(), Request.Thumbnail.Get().Num());
+		ThumbnailChunk.bCompress = false;
+		ChunkSections.AddDefaulted();
+	}
+
+	FGuid NewJournalBaseId;
+	if (Request.bJournal)
+	{
+		NewJournalBaseId = FGuid::NewGuid();
+		FSaveGameChunk& JournalBaseChunk = Chunks.Add_GetRef({ESaveGameChunkType::JournalBase});
+		FSaveGameJournal::SerializeBaseId(NewJournalBaseId, JournalBaseChunk.Data);
+		ChunkSections.AddDefaulted();
+	}
+
+	// Only kept when the sections are hashed, otherwise they could never be reused
+	TArray<TSharedPtr<const FEncodedSaveGameChunk>> EncodedChunks;
+	TArray<TSharedPtr<const FEncodedSaveGameChunk>>* OutEncodedChunks = Request.SectionHashes.IsEmpty() ? nullptr : &EncodedChunks;
+	FSaveGameFileWriteStats FileStats;
+	const bool bWritten = FSaveGameContainer::Write(Request.SaveFilename, Chunks, Request.CompressionFormat, Request.CompressionLevel, &FileStats, OutEncodedChunks);
+	AddFileWriteStats(FileStats, OutStats);
+	if (!bWritten)
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index != EncodedChunks.Num(); ++Index)
+	{
+		if (!ChunkSections[Index].IsEmpty() && Request.SectionHashes.Contains(ChunkSections[Index]))
+		{
+			OutSections.Add(ChunkSections[Index], EncodedChunks[Index]);
+		}
+	}
+
+	// Until the new journal is in place, the old one no longer matches the base and is ignored.
+	// The journal is written through the file manager, so it is only kept next to a base that is a plain file as well.
+	if (Request.bJournal && FSaveGameContainer::IsStoredInPlace(Request.SaveFilename))
+	{
+		if (!FSaveGameJournal::Create(Request.JournalFilename, NewJournalBaseId))
+		{
+			return false;
+		}
+
+		OutJournalBaseId = NewJournalBaseId;
+	}
+
+	// Single file slots are listed by the timestamp of the save file itself
+	if (Request.bSingleFile && Request.MetadataIndexEntry.IsValid())
+	{
+		FSaveGameMetadataIndexEntry IndexEntry = *Request.MetadataIndexEntry;
+		IndexEntry.Timestamp = IFileManager::Get().GetTimeStamp(*Request.SaveFilename);
+		FSaveGameMetadataIndex::UpdateEntry(Request.MetadataIndexFilename, IndexEntry);
+	}
+
+	return true;
+}
+
+USaveGameData* USaveGameSubsystem::ReadSaveGameFromDisk(const FString& SlotName) const
+{
+	SAVESYSTEM_PHASE_SCOPE(ReadSaveFile);
+
+	const FString SaveFilename = GetSaveFilename(SlotName);
+
+	FSaveGameContainer Container;
+	if (!Container.Open(SaveFilename))
+	{
+		// Saves written before the chunked container was introduced
+		return Container.IsContainer() ? nullptr : Cast<USaveGameData>(UGameplayStatics::LoadGameFromSlot(SlotName, 0));
+	}
+
+	USaveGameData* SaveGame = NewSaveGameDataObject();
+
+	if (const FSaveGameChunkEntry* PlayerEntry = Container.FindEntry(ESaveGameChunkType::Player))
+	{
+		Container.ReadStruct(*PlayerEntry, FPlayerStateSaveData::StaticStruct(), &SaveGame->PlayerStateSaveData);
+	}
+
+	if (const FSaveGameChunkEntry* AbilitySystemEntry = Container.FindEntry(ESaveGameChunkType::AbilitySystem))
+	{
+		Container.ReadStruct(*AbilitySystemEntry, FAbilitySystemSaveData::StaticStruct(), &SaveGame->AbilitySystemSaveData);
+	}
+
+	// Only the chunks of levels that are currently loaded are deserialized, the others are kept encoded
+	TSet<FString> ResidentLevels;
+	if (USavableActorRegistry* Registry = GetSavableActorRegistry())
+	{
+		for (const TPair<TObjectKey<ULevel>, FSavableLevelActors>& LevelPair : Registry->GetLevels())
+		{
+			ResidentLevels.Add(LevelPair.Value.Key);
+		}
+	}
+
+	// Chunks written by another build have to be converted before they can be written back unchanged
+	const bool bCanKeepEncoded = Container.HasCurrentVersions();
+
+	for (const FSaveGameChunkEntry& Entry : Container.GetEntries())
+	{
+		if (Entry.Type != ESaveGameChunkType::Level)
+		{
+			continue;
+		}
+
+		// The collection of saves from before per-level keys stands in for every level, so it is always decoded
+		if (bCanKeepEncoded && !ResidentLevels.Contains(Entry.Name) && Entry.Name != LegacyLevelKey)
+		{
+			TSharedRef<FEncodedSaveGameChunk> LevelChunk = MakeShared<FEncodedSaveGameChunk>();
+			if (Container.ReadEncodedChunk(Entry, *LevelChunk))
+			{
+				SaveGame->UnloadedLevelChunks.Add(Entry.Name, LevelChunk);
+			}
+			continue;
+		}
+
+		FLevelActorCollection& LevelActorCollection = SaveGame->LevelActorCollections.Add(Entry.Name);
+		if (!Container.ReadStruct(Entry, FLevelActorCollection::StaticStruct(), &LevelActorCollection))
+		{
+			UE_LOG(LogSaveSystem, Warning, TEXT("Failed to read level %s from slot %s"), *Entry.Name, *SlotName);
+			SaveGame->LevelActorCollections.Remove(Entry.Name);
+		}
+	}
+
+	if (const FSaveGameChunkEntry* JournalBaseEntry = Container.FindEntry(ESaveGameChunkType::JournalBase))
+	{
+		TArray<uint8> BaseIdBytes;
+		FGuid BaseId;
+		FSaveGameJournal Journal;
+		
+		if (FSaveGameContainer::IsStoredInPlace(SaveFilename)
+			&& Container.ReadChunk(*JournalBaseEntry, BaseIdBytes) && FSaveGameJournal::DeserializeBaseId(BaseIdBytes, BaseId)
+			&& Journal.Open(GetJournalFilename(SlotName)) && Journal.GetBaseId() == BaseId)
+		{
+			const int32 NumRecords = Journal.Replay(*SaveGame, Container, ResidentLevels);
+			UE_LOG(LogSaveSystem, Verbose, TEXT("Replayed %d journal records on slot %s"), NumRecords, *SlotName);
+		}
+	}
+
+	return SaveGame;
+}
+
+bool USaveGameSubsystem::ValidateSaveGame(FString InSlotName, bool bVerifyChecksums) const
+{
+	FSaveGameContainer Container;
+	return Container.Open(GetSaveFilename(GetFullSlotName(InSlotName))) && Container.Validate(bVerifyChecksums);
+}
+
+void USaveGameSubsystem::DeleteSaveGame(FString InSlotName)
+{
+	if (InSlotName.IsEmpty())
+	{
+		return;
+	}
+
+	// A queued write of the slot would bring it back
+	FlushSaveGameWrites();
+
+	const FString SlotName = GetFullSlotName(InSlotName);
+	const FString SaveFilename = GetSaveFilename(SlotName);
+	const FString JsonFilename = FPaths::ChangeExtension(SaveFilename, TEXT("json"));
+	const FString MetadataFilename = Settings->bSingleFileSlots ? SaveFilename : JsonFilename;
+
+	// Single file slots may still have the json file of a save written before they were enabled
+	IFileManager& FileManager = IFileManager::Get();
+	FSaveGameContainer::Delete(SaveFilename);
+	FileManager.Delete(*JsonFilename, false, true, true);
+	FileManager.Delete(*GetJournalFilename(SlotName), false, true, true);
+
+	if (ScreenshotTaker)
+	{
+		const FString ThumbnailFilename = GetThumbnailFilename(MetadataFilename);
+		if (!Settings->bSingleFileSlots)
+		{
+			FileManager.Delete(*ThumbnailFilename, false, true, true);
+		}
+
+		if (ThumbnailCache)
+		{
+			ThumbnailCache->Invalidate(ThumbnailFilename);
+		}
+	}
+
+	if (IsJournalSlot(SlotName))
+	{
+		LastJournaledSaveGame = nullptr;
+		JournalBaseId.Invalidate();
+	}
+
+	// The deleted slot may hold the autosave that the next one would be skipped for
+	LastAutosaveSectionHashes.Reset();
+
+	FString MetadataKey = MetadataFilename;
+	FPaths::MakePathRelativeTo(MetadataKey, *(GetSaveDirectory() / TEXT("")));
+	FSaveGameMetadataIndex::RemoveEntry(GetMetadataIndexFilename(), MetadataKey);
+
+	FCachedSaveGameMetadata CachedMetadata;
+	if (MetadataCache.RemoveAndCopyValue(MetadataKey, CachedMetadata))
+	{
+		LoadedMetadata.Remove(CachedMetadata.Metadata);
+	}
+
+	UE_LOG(LogSaveSystem, Display, TEXT("Deleted slot %s"), *SlotName);
+}
+
+void USaveGameSubsystem::LoadSaveGame(FString InSlotName)
+{
+	SAVESYSTEM_PHASE_SCOPE(LoadSaveGame);
+
+	SetSlotName(InSlotName);
+	FlushSaveGameWrites();
+	
+	if (FSaveGameContainer::FileExists(GetSaveFilename(CurrentSlotName)))
+	{
+		CurrentSaveGame = ReadSaveGameFromDisk(CurrentSlotName);
+		if (!CurrentSaveGame)
+		{
+			UE_LOG(LogSaveSystem, Warning, TEXT("Failed to load SaveGameData slot %s"), *CurrentSlotName);
+			return;
+		}
+		
+		UE_LOG(LogSaveSystem, Display, TEXT("Loaded SaveGameData from slot %s"), *CurrentSlotName);
+
+		for (TPair<FString, FLevelActorCollection>& Pair : CurrentSaveGame->LevelActorCollections)
+		{
+			Pair.Value.BuildIndex();
+		}
+
+		UnloadedLevelChunks = CurrentSaveGame->UnloadedLevelChunks;
+		AppliedLevels.Reset();
+
+		// The world now holds the loaded state, which may differ from the one written last
+		LastAutosaveSectionHashes.Reset();
+		
+		if (USavableActorRegistry* Registry = GetSavableActorRegistry())
+		{
+			for (const TPair<TObjectKey<ULevel>, FSavableLevelActors>& LevelPair : Registry->GetLevels())
+			{
+				const FSavableLevelActors& LevelActors = LevelPair.Value;
+				if (const FLevelActorCollection* LevelActorCollection = FindLevelActorCollection(LevelActors.Key))
+				{
+					ApplyLevelState(LevelActors, *LevelActorCollection);
+				}
+				
+				AppliedLevels.Add(LevelActors.Key);
+			}
+		}
+
+		// Loaded records match the actors now, everything marked before the load is stale
+		FSaveDirtyTracker::Get().Reset();
+
+		OnSaveGameLoaded.Broadcast(CurrentSaveGame);
+	}
+	else
+	{
+		CreateSaveGameDataObject();
+		UE_LOG(LogSaveSystem, Display, TEXT("Created new SaveGameData object"));
+	}
+}
+
+void USaveGameSubsystem::ApplyLevelState(const FSavableLevelActors& LevelActors, const FLevelActorCollection& LevelActorCollection)
+{
+	SAVESYSTEM_PHASE_SCOPE(ApplyLevelState);
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Destroying unregisters actors, so they are collected first to keep the registry stable during iteration
+	TArray<AActor*> ActorsToDestroy;
+
+	// Object paths of the table are resolved once for the whole level
+	FSaveGameActorArchive::FReader Reader(LevelActorCollection.StringTable, true);
+	
+	for (const TWeakObjectPtr<AActor>& WeakActor : LevelActors.Actors)
+	{
+		AActor* Actor = WeakActor.Get();
+		if (!IsValid(Actor))
+		{
+			continue;
+		}
+		
+		const FActorSaveData* ActorData = LevelActorCollection.FindActor(Actor->GetFName(), ISavableObjectInterface::Execute_GetPersistentSaveId(Actor));
+		if (!ActorData)
+		{
+			ActorsToDestroy.Add(Actor);
+			continue;
+		}
+
+		Actor->SetActorTransform(ActorData->Transform);
+
+		FMemoryReaderView MemReader(LevelActorCollection.GetActorBytes(*ActorData));
+		if (LevelActorCollection.ActorFormat == ESavedActorFormat::StringTable)
+		{
+			const FSavePropertyPlan* Plan = ActorData->bPropertyPlan ? &FSavePropertyPlan::Get(Actor->GetClass()) : nullptr;
+			SerializeActorSaveData(Actor, MemReader, Reader, Plan, ActorData->bUnversioned);
+		}
+		else
+		{
+			DeserializeNameAsStringActorSaveData(Actor, MemReader);
+		}
+		ISavableObjectInterface::Execute_OnObjectLoaded(Actor);
+	}
+
+	for (AActor* Actor : ActorsToDestroy)
+	{
+		Actor->Destroy();
+	}
+
+	FSaveSystemStats::Get().RecordLevelApply(LevelActors.Key, FPlatformTime::Seconds() - StartTime);
+}
+
+void USaveGameSubsystem::HandleWorldInitializedActors(const FActorsInitializedParams& Params)
+{
+	if (Params.World && Params.World->GetGameInstance() == GetGameInstance())
+	{
+		BindToRegistry(Params.World->GetSubsystem<USavableActorRegistry>());
+	}
+}
+
+void USaveGameSubsystem::BindToRegistry(USavableActorRegistry* Registry)
+{
+	if (!Registry || Registry->OnLevelAdded.IsBoundToObject(this))
+	{
+		return;
+	}
+
+	Registry->OnLevelAdded.AddUObject(this, &ThisClass::HandleLevelAdded);
+	Registry->OnLevelRemoving.AddUObject(this, &ThisClass::HandleLevelRemoving);
+}
+
+const FLevelActorCollection* USaveGameSubsystem::FindLevelActorCollection(const FString& LevelKey) const
+{
+	if (!CurrentSaveGame)
+	{
+		return nullptr;
+	}
+
+	if (const FLevelActorCollection* LevelActorCollection = CurrentSaveGame->LevelActorCollections.Find(LevelKey))
+	{
+		return LevelActorCollection;
+	}
+
+	// Actors are matched by name or persistent id, so the shared collection works for every level it holds actors of
+	return CurrentSaveGame->LevelActorCollections.Find(LegacyLevelKey);
+}
+
+void USaveGameSubsystem::HandleLevelAdded(const FSavableLevelActors& LevelActors)
+{
+	// The level is resident now, so its state is captured with the other loaded levels again
+	TSharedPtr<const FEncodedSaveGameChunk> LevelChunk;
+	if (const TSharedRef<const FEncodedSaveGameChunk>* UnloadedLevelChunk = UnloadedLevelChunks.Find(LevelActors.Key))
+	{
+		LevelChunk = *UnloadedLevelChunk;
+		UnloadedLevelChunks.Remove(LevelActors.Key);
+	}
+
+	// A chunk captured when the level streamed out this session is applied even if no save was loaded
+	if (AppliedLevels.Contains(LevelActors.Key) || (!CurrentSaveGame && !LevelChunk))
+	{
+		return;
+	}
+
+	AppliedLevels.Add(LevelActors.Key);
+
+	if (LevelChunk)
+	{
+		TArray<uint8> Bytes;
+		FLevelActorCollection LevelActorCollection;
+		if (FSaveGameContainer::Decompress(*LevelChunk, Bytes)
+			&& FSaveGameContainer().DeserializeStruct(Bytes, FLevelActorCollection::StaticStruct(), &LevelActorCollection))
+		{
+			LevelActorCollection.BuildIndex();
+			ApplyLevelState(LevelActors, LevelActorCollection);
+		}
+	}
+	else if (const FLevelActorCollection* LevelActorCollection = FindLevelActorCollection(LevelActors.Key))
+	{
+		ApplyLevelState(LevelActors, *LevelActorCollection);
+	}
+	
+	UE_LOG(LogSaveSystem, Verbose, TEXT("Applied saved state to streamed in level %s"), *LevelActors.Key);
+}
+
+void USaveGameSubsystem::HandleLevelRemoving(const FSavableLevelActors& LevelActors)
+{
+	AppliedLevels.Remove(LevelActors.Key);
+
+	// Capture the level before it is gone, so that its state survives until it streams in again
+	TMap<FString, FLevelActorCollection> Collections;
+	const TMap<FObjectKey, ESaveDirtyFlags> NoDirtyObjects;
+	CaptureLevelActors({&LevelActors}, nullptr, NoDirtyObjects, Collections);
+
+	if (const FLevelActorCollection* LevelActorCollection = Collections.Find(LevelActors.Key))
+	{
+		// Stored uncompressed, the writer compresses it with the rest of the save
+		TSharedRef<FEncodedSaveGameChunk> LevelChunk = MakeShared<FEncodedSaveGameChunk>();
+		FSaveGameContainer::SerializeStruct(FLevelActorCollection::StaticStruct(), LevelActorCollection, LevelChunk->Data);
+		LevelChunk->UncompressedSize = LevelChunk->Data.Num();
+		UnloadedLevelChunks.Add(LevelActors.Key, LevelChunk);
+	}
+}
+
+void USaveGameSubsystem::LoadPlayerAbilitySystemState()
+{
+	SAVESYSTEM_PHASE_SCOPE(LoadAbilitySystemState);
+
+	if (UAbilitySystemComponent* ASC = FindPlayerAbilitySystemComponent())
+	{
+		ApplyAbilitySystem(ASC, CurrentSaveGame->AbilitySystemSaveData);
+	}
+}
+
+void USaveGameSubsystem::ApplyAbilitySystem(UAbilitySystemComponent* ASC, const FAbilitySystemSaveData& Data)
+{
+	if (Settings->bBatchAbilitySystemRestore)
+	{
+		ApplyAbilitySystemBatched(ASC, Data);
+		return;
+	}
+
+	ApplyAttributeSets(ASC, Data);
+
+	for (const FGameplayAbilitySaveData& AbilityData : Data.SavedAbilities)
+	{
+		UGameplayAbility* AbilityCDO = AbilityData.AbilityClass->GetDefaultObject<UGameplayAbility>();
+
+		FGameplayAbilitySpec AbilitySpec(AbilityCDO, AbilityData.Level);
+		AbilitySpec.DynamicAbilityTags = AbilityData.DynamicTags;
+
+		ASC->GiveAbility(AbilitySpec);
+		ISavableObjectInterface::Execute_OnObjectLoaded(AbilityCDO);
+	}
+	
+	for (const FGameplayEffectSaveData& EffectData : Data.SavedGameplayEffects)
+	{
+		UGameplayEffect* GameplayEffectCDO = EffectData.EffectClass->GetDefaultObject<UGameplayEffect>();
+		ASC->ApplyGameplayEffectToSelf(GameplayEffectCDO, EffectData.Level, ASC->MakeEffectContext());
+		ISavableObjectInterface::Execute_OnObjectLoaded(GameplayEffectCDO);
+	}
+}
+
+void USaveGameSubsystem::ApplyAbilitySystemBatched(UAbilitySystemComponent* ASC, const FAbilitySystemSaveData& Data)
+{
+	// Aggregators dirtied by the restored attributes and effects recompute and broadcast once, when the batch ends
+	FScopedAggregatorOnDirtyBatch AggregatorBatch;
+
+	ApplyAttributeSets(ASC, Data);
+
+	{
+		// Specs given under the lock are added to the ability list in one pass when it is released
+		FScopedAbilityListLock AbilityListLock(*ASC);
+		for (const FGameplayAbilitySaveData& AbilityData : Data.SavedAbilities)
+		{
+			UGameplayAbility* AbilityCDO = AbilityData.AbilityClass->GetDefaultObject<UGameplayAbility>();
+
+			FGameplayAbilitySpec AbilitySpec(AbilityCDO, AbilityData.Level);
+			AbilitySpec.DynamicAbilityTags = AbilityData.DynamicTags;
+
+			ASC->GiveAbility(AbilitySpec);
+			ISavableObjectInterface::Execute_OnObjectLoaded(AbilityCDO);
+		}
+	}
+
+	// Effects with a duration join the active effects container in one pass when the lock is released
+	FScopedActiveGameplayEffectLock EffectLock(ASC->ActiveGameplayEffects);
+	for (const FGameplayEffectSaveData& EffectData : Data.SavedGameplayEffects)
+	{
+		UGameplayEffect* GameplayEffectCDO = EffectData.EffectClass->GetDefaultObject<UGameplayEffect>();
+		ASC->ApplyGameplayEffectToSelf(GameplayEffectCDO, EffectData.Level, ASC->MakeEffectContext());
+		ISavableObjectInterface::Execute_OnObjectLoaded(GameplayEffectCDO);
+	}
+}
+
+void USaveGameSubsystem::ApplyAttributeSets(UAbilitySystemComponent* ASC, const FAbilitySystemSaveData& Data)
+{
+	const TArray<UAttributeSet*>& AttrSets = ASC->GetSpawnedAttributes();
+	const TArray<FAttributeSetSaveData>& SavedAttributeSets = Data.SavedAttributeSets;
+	for (UAttributeSet* AttrSet : AttrSets)
+	{
+		if (!SavedAttributeSets.IsEmpty())
+		{
+			const FAttributeSetLayout& Layout = FAttributeSetLayout::Get(AttrSet->GetClass());
+			if (const FAttributeSetSaveData* SetData = SavedAttributeSets.FindByPredicate([&Layout](const FAttributeSetSaveData& Saved) { return Saved.SetName == Layout.GetSetName(); }))
+			{
+				Layout.Load(AttrSet, *SetData);
+			}
+			continue;
+		}
+
+		// Saves from before the attribute set layouts
+		for (TFieldIterator<FProperty> It(AttrSet->GetClass(), EFieldIterationFlags::IncludeSuper); It; ++It)
+		{
+			FProperty* Property = *It;
+
+			if (!FGameplayAttribute::IsGameplayAttributeDataProperty(Property))
+			{
+				continue;
+			}
+
+			if (const FAttributeSaveData* AttrSaveData = Data.SavedAttributes.Find(GetAttributeName(Property)))
+			{
+				FGameplayAttributeData* DataPtr = GetAttributeData(Property, AttrSet);
+				DataPtr->SetBaseValue(AttrSaveData->BaseValue);
+				DataPtr->SetCurrentValue(AttrSaveData->BaseValue);
+			}
+		}
+	}
+}
+
+const TArray<USaveGameMetadata*>& USaveGameSubsystem::LoadAllSaveGameMetadata()
+{
+	SAVESYSTEM_PHASE_SCOPE(LoadAllMetadata);
+
+	LoadedMetadata.Empty();
+	
+	if (!Settings->bCreateMetadata)
+	{
+		return LoadedMetadata; // Empty array
+	}
+
+	const FString SaveDirectory = GetSaveDirectory();
+	const FString MetadataClassPath = MetadataCDO->GetClass()->GetPathName();
+	const TCHAR* MetadataExtension = Settings->bSingleFileSlots ? TEXT("sav") : TEXT("json");
+
+	// Player records have the extension of single file slots, but belong to no slot
+	const FString PlayersPrefix = FString(PlayersDirectory) / TEXT("");
+
+	// Modification times come from the directory listing, no metadata file is opened for slots that did not change
+	TMap<FString, FDateTime> MetadataTimestamps;
+	IFileManager::Get().IterateDirectoryStatRecursively(*SaveDirectory, [&](const TCHAR* Path, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory && FPaths::GetExtension(Path) == MetadataExtension)
+		{
+			FString Key = Path;
+			FPaths::MakePathRelativeTo(Key, *(SaveDirectory / TEXT("")));
+			if (!Key.StartsWith(PlayersPrefix))
+			{
+				MetadataTimestamps.Add(MoveTemp(Key), StatData.ModificationTime);
+			}
+		}
+		return true;
+	});
+
+	FSaveGameMetadataIndex Index;
+	const FString IndexFilename = GetMetadataIndexFilename();
+	bool bIndexChanged = !Index.Load(IndexFilename);
+
+	for (auto It = Index.Entries.CreateIterator(); It; ++It)
+	{
+		if (!MetadataTimestamps.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+			bIndexChanged = true;
+		}
+	}
+
+	TMap<FString, FCachedSaveGameMetadata> PreviousCache = MoveTemp(MetadataCache);
+	MetadataCache.Reset();
+
+	for (const TPair<FString, FDateTime>& Pair : MetadataTimestamps)
+	{
+		const FString MetadataPath = SaveDirectory / Pair.Key;
+		
+		const FCachedSaveGameMetadata* CachedMetadata = PreviousCache.Find(Pair.Key);
+		if (CachedMetadata && CachedMetadata->Metadata && CachedMetadata->Timestamp == Pair.Value)
+		{
+			MetadataCache.Add(Pair.Key, *CachedMetadata);
+			LoadedMetadata.Add(CachedMetadata->Metadata);
+			continue;
+		}
+
+		USaveGameMetadata* Metadata = nullptr;
+
+		const FSaveGameMetadataIndexEntry* IndexEntry = Index.Entries.Find(Pair.Key);
+		if (IndexEntry && IndexEntry->Timestamp == Pair.Value && IndexEntry->ClassPath == MetadataClassPath)
+		{
+			Metadata = NewObject<USaveGameMetadata>(GetTransientPackage(), MetadataCDO->GetClass());
+			if (!FSaveGameMetadataIndex::DeserializeMetadata(IndexEntry->Data, Metadata))
+			{
+				Metadata = nullptr;
+			}
+		}
+
+		// Slots written by an older version or changed outside of the game fall back to their json file
+		TSharedPtr<const FSaveGameChunkEntry> ThumbnailEntry;
+		if (!Metadata)
+		{
+			Metadata = ReadMetadata(MetadataPath, &ThumbnailEntry);
+			if (!Metadata)
+			{
+				continue;
+			}
+
+			FSaveGameMetadataIndexEntry& NewEntry = Index.Entries.Add(Pair.Key);
+			NewEntry.Key = Pair.Key;
+			NewEntry.ClassPath = MetadataClassPath;
+			NewEntry.Timestamp = Pair.Value;
+			FSaveGameMetadataIndex::SerializeMetadata(Metadata, NewEntry.Data);
+			bIndexChanged = true;
+		}
+
+		// The slot has been written since its screenshot was cached
+		if (CachedMetadata && ThumbnailCache)
+		{
+			ThumbnailCache->Invalidate(GetThumbnailFilename(MetadataPath));
+		}
+
+		FCachedSaveGameMetadata& NewCachedMetadata = MetadataCache.Add(Pair.Key);
+		NewCachedMetadata.Metadata = Metadata;
+		NewCachedMetadata.Timestamp = Pair.Value;
+		NewCachedMetadata.ThumbnailEntry = ThumbnailEntry;
+		LoadedMetadata.Add(Metadata);
+	}
+
+	if (bIndexChanged)
+	{
+		Index.Save(IndexFilename);
+	}
+
+	return LoadedMetadata;
+}
+
+void USaveGameSubsystem::LoadMetadataScreenshot(USaveGameMetadata* Metadata)
+{
+	if (!Metadata || !ThumbnailCache)
+	{
+		return;
+	}
+
+	for (const TPair<FString, FCachedSaveGameMetadata>& Pair : MetadataCache)
+	{
+		if (Pair.Value.Metadata == Metadata)
+		{
+			const FString MetadataPath = GetSaveDirectory() / Pair.Key;
+			ThumbnailCache->RequestThumbnail(Metadata, GetThumbnailFilename(MetadataPath), Settings->bSingleFileSlots, Pair.Value.ThumbnailEntry);
+			return;
+		}
+	}
+
+	UE_LOG(LogSaveSystem, Warning, TEXT("Metadata %s was not listed by LoadAllSaveGameMetadata."), *Metadata->GetName());
+}
+
+void USaveGameSubsystem::SaveAllPlayers()
+{
+	const AGameStateBase* GameState = GetWorld() ? GetWorld()->GetGameState() : nullptr;
+	if (!GameState)
+	{
+		return;
+	}
+
+	for (APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		SavePlayer(PlayerState);
+	}
+}
+
+void USaveGameSubsystem::SavePlayer(APlayerState* PlayerState)
+{
+	if (!IsValid(PlayerState))
+	{
+		return;
+	}
 
-	if (!ASC)
+	if (GetPlayerSaveId(PlayerState).IsEmpty())
 	{
+		UE_LOG(LogSaveSystem, Warning, TEXT("Player %s has no unique net id, its state is not saved."), *PlayerState->GetPlayerName());
 		return;
 	}
 
-	const TArray<FGameplayAbilitySpec>& AbilitySpecs = ASC->GetActivatableAbilities();
-	for (const FGameplayAbilitySpec& Spec : AbilitySpecs)
+	// Captured right away, so that SaveAllPlayers saves every player with the state of the same frame
+	TSharedRef<FPlayerSaveRecord> Record = MakeShared<FPlayerSaveRecord>();
 	{
-		UGameplayAbility* Ability = Spec.Ability;
+		SAVESYSTEM_PHASE_SCOPE(CapturePlayerRecords);
+		CapturePlayerRecord(PlayerState, *Record);
+	}
 
-		if (!Ability->Implements<USavableObjectInterface>())
-		{
-			continue;
-		}
+	// A record that is still queued is replaced by the newer one of the same player
+	const int32 PendingIndex = PendingPlayerRecords.IndexOfByPredicate([&Record](const TSharedRef<const FPlayerSaveRecord>& Pending)
+	{
+		return Pending->PlayerId == Record->PlayerId;
+	});
 
-		FGameplayAbilitySaveData AbilityData;
-		AbilityData.AbilityClass = Ability->GetClass();
-		AbilityData.Level = Ability->GetAbilityLevel();
-		AbilityData.DynamicTags = Spec.DynamicAbilityTags;
+	if (PendingIndex != INDEX_NONE)
+	{
+		PendingPlayerRecords[PendingIndex] = Record;
+	}
+	else
+	{
+		PendingPlayerRecords.Add(Record);
+	}
 
-		CurrentSaveGame->SavedPlayerAbilities.Add(AbilityData);
+	if (!PlayerSaveTickerHandle.IsValid())
+	{
+		PlayerSaveTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickPlayerSaves));
 	}
+}
 
-	TArray<FGameplayEffectSpec> EffectSpecs;
-	ASC->GetAllActiveGameplayEffectSpecs(EffectSpecs);
+bool USaveGameSubsystem::TickPlayerSaves(float DeltaTime)
+{
+	CollectFinishedPlayerWrites();
 
-	for (const FGameplayEffectSpec& Spec : EffectSpecs)
+	// Records of players whose previous record is still being written stay queued, so that a file is never written twice at once
+	const int32 MaxWrites = Settings->PlayerSavesPerFrame > 0 ? Settings->PlayerSavesPerFrame : MAX_int32;
+	int32 NumWrites = 0;
+	for (int32 Index = 0; Index < PendingPlayerRecords.Num() && NumWrites < MaxWrites;)
 	{
-		const UGameplayEffect* Effect = Spec.Def;
-
-		if (!Effect->Implements<USavableObjectInterface>())
+		if (PlayerWriteTasks.Contains(PendingPlayerRecords[Index]->PlayerId))
 		{
+			++Index;
 			continue;
 		}
 
-		FGameplayEffectSaveData EffectData;
-		EffectData.Level = Spec.GetLevel();
-		EffectData.EffectClass = Effect->GetClass();
-
-		CurrentSaveGame->SavedGameplayEffects.Add(EffectData);
+		StartPlayerWrite(PendingPlayerRecords[Index]);
+		PendingPlayerRecords.RemoveAt(Index);
+		++NumWrites;
 	}
 
-	const TArray<UAttributeSet*>& AttrSets = ASC->GetSpawnedAttributes();
-	for (UAttributeSet* AttrSet : AttrSets)
+	if (PendingPlayerRecords.IsEmpty() && PlayerWriteTasks.IsEmpty())
 	{
-		for (TFieldIterator<FProperty> It(AttrSet->GetClass(), EFieldIterationFlags::IncludeSuper); It; ++It)
-		{
-			FProperty* Property = *It;
-
-			if (FGameplayAttribute::IsGameplayAttributeDataProperty(Property))
-			{
-				const FGameplayAttributeData* DataPtr = GetAttributeData(Property, AttrSet);
-				CurrentSaveGame->SavedAttributes.Add(GetAttributeName(Property), FAttributeSaveData(DataPtr->GetBaseValue()));
-			}
-		}
+		PlayerSaveTickerHandle.Reset();
+		return false;
 	}
+
+	return true;
 }
 
-void USaveGameSubsystem::SavePlayerState()
+void USaveGameSubsystem::StartPlayerWrite(const TSharedRef<const FPlayerSaveRecord>& Record)
 {
-	APawn* Pawn = GetPlayerState()->GetPawn();
-	if (!ensure(Pawn))
+	// Records are independent files, so every player is serialized and written on its own worker
+	PlayerWriteTasks.Add(Record->PlayerId, Async(EAsyncExecution::ThreadPool, [Record, Filename = GetPlayerSaveFilename(Record->PlayerId),
+		CompressionFormat = Settings->SaveCompressionFormat, CompressionLevel = Settings->SaveCompressionLevel]
 	{
-		return;
-	}
-	
-	CurrentSaveGame->PlayerStateSaveData.Transform = Pawn->GetTransform();
-
-	// Temp
-	CurrentSaveGame->PlayerStateSaveData.bResumeAtTransform = true;
+		return WritePlayerRecordToDisk(*Record, Filename, CompressionFormat, CompressionLevel);
+	}));
 }
 
-void USaveGameSubsystem::HandleAutosave()
+void USaveGameSubsystem::CollectFinishedPlayerWrites()
 {
-	if (!Settings->bEnableAutosave)
-	{
-		return;
-	}
-	
-	AsyncTask(ENamedThreads::GameThread, [this]
+	for (auto It = PlayerWriteTasks.CreateIterator(); It; ++It)
 	{
-		while (true)
+		if (It.Value().IsReady())
 		{
-			if (AutosaveCondition->IsAutosavePossible())
-			{
-				OnAutosaveStarted.Broadcast(CurrentSaveGame);
-				
-				SetSlotName(GetAutosaveSlotName());
-				SaveGameState();
-				RequestScreenshot();
-				
-				OnAutosaveFinished.Broadcast(CurrentSaveGame);
-				
-				FTimerManager& TimerManager = GetWorld()->GetTimerManager();
-				TimerManager.ClearTimer(AutosaveTimer);
-				TimerManager.SetTimer(AutosaveTimer, this, &ThisClass::HandleAutosave, Settings->AutosavePeriod);
-				
-				break;
-			}
+			UE_CLOG(!It.Value().Get(), LogSaveSystem, Error, TEXT("Failed to write the record of player %s"), *It.Key());
+			It.RemoveCurrent();
 		}
-	});
-}
-
-void USaveGameSubsystem::SaveGameToSlot()
-{
-	SaveMetadata();
-	UGameplayStatics::SaveGameToSlot(CurrentSaveGame, CurrentSlotName, 0);
-	UE_LOG(LogSaveSystem, Display, TEXT("Wrote SaveGameData to slot %s"), *CurrentSlotName)
+	}
 }
 
-void USaveGameSubsystem::LoadSaveGame(FString InSlotName)
+void USaveGameSubsystem::FlushPlayerSaves()
 {
-	SetSlotName(InSlotName);
-	
-	if (UGameplayStatics::DoesSaveGameExist(CurrentSlotName, 0))
+	while (!PendingPlayerRecords.IsEmpty() || !PlayerWriteTasks.IsEmpty())
 	{
-		CurrentSaveGame = Cast<USaveGameData>(UGameplayStatics::LoadGameFromSlot(CurrentSlotName, 0));
-		if (!CurrentSaveGame)
+		for (TPair<FString, TFuture<bool>>& Pair : PlayerWriteTasks)
 		{
-			UE_LOG(LogSaveSystem, Warning, TEXT("Failed to load SaveGameData slot %s"), *CurrentSlotName);
-			return;
+			Pair.Value.Wait();
 		}
-		
-		UE_LOG(LogSaveSystem, Display, TEXT("Loaded SaveGameData from slot %s"), *CurrentSlotName);
 
-		for (AActor* Actor : TActorRange<AActor>(GetWorld()))
+		CollectFinishedPlayerWrites();
+
+		// Every write was collected above and queued records have distinct players, so each of them can be written now
+		for (const TSharedRef<const FPlayerSaveRecord>& Record : PendingPlayerRecords)
 		{
-			if (!Actor->Implements<USavableObjectInterface>())
-			{
-				continue;
-			}
+			StartPlayerWrite(Record);
+		}
+		PendingPlayerRecords.Reset();
+	}
 
-			bool bIsActorValid = false;
-			
-			FLevelActorCollection* ActorLevelCollection = CurrentSaveGame->LevelActorCollections.Find(Actor->GetLevel()->GetName());
+	if (PlayerSaveTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(PlayerSaveTickerHandle);
+		PlayerSaveTickerHandle.Reset();
+	}
+}
 
-			if (!ActorLevelCollection)
-			{
-				Actor->Destroy();
-				continue;
-			}
-			
-			for (FActorSaveData ActorData : ActorLevelCollection->SavedActors)
-			{
-				if (ActorData.Name == Actor->GetFName())
-				{
-					Actor->SetActorTransform(ActorData.Transform);
+bool USaveGameSubsystem::LoadPlayer(APlayerState* PlayerState)
+{
+	SAVESYSTEM_PHASE_SCOPE(LoadPlayerRecord);
 
-					FMemoryReader MemReader(ActorData.ByteData);
-					FObjectAndNameAsStringProxyArchive Archive(MemReader, true);
-					Archive.ArIsSaveGame = true;
-					Actor->Serialize(Archive);
-					ISavableObjectInterface::Execute_OnObjectLoaded(Actor);
+	const FString PlayerId = GetPlayerSaveId(PlayerState);
+	if (PlayerId.IsEmpty())
+	{
+		return false;
+	}
 
-					bIsActorValid = true;
+	// A record that still waits for its write is newer than the file, so it is applied from memory
+	const TSharedRef<const FPlayerSaveRecord>* PendingRecord = PendingPlayerRecords.FindByPredicate([&PlayerId](const TSharedRef<const FPlayerSaveRecord>& Pending)
+	{
+		return Pending->PlayerId == PlayerId;
+	});
 
-					break;
-				}
-			}
+	if (PendingRecord)
+	{
+		ApplyPlayerRecord(PlayerState, **PendingRecord);
+		return true;
+	}
 
-			if (!bIsActorValid)
-			{
-				Actor->Destroy();
-			}
-		}
+	// A player that reconnects right after leaving may still have its record in flight
+	if (TFuture<bool>* WriteTask = PlayerWriteTasks.Find(PlayerId))
+	{
+		WriteTask->Wait();
+	}
 
-		OnSaveGameLoaded.Broadcast(CurrentSaveGame);
+	FSaveGameContainer Container;
+	if (!Container.Open(GetPlayerSaveFilename(PlayerId)))
+	{
+		return false;
 	}
-	else
+
+	FPlayerSaveRecord Record;
+	const FSaveGameChunkEntry* PlayerEntry = Container.FindEntry(ESaveGameChunkType::Player);
+	const FSaveGameChunkEntry* AbilitySystemEntry = Container.FindEntry(ESaveGameChunkType::AbilitySystem);
+	if (!PlayerEntry || !Container.ReadStruct(*PlayerEntry, FPlayerStateSaveData::StaticStruct(), &Record.PlayerStateSaveData)
+		|| !AbilitySystemEntry || !Container.ReadStruct(*AbilitySystemEntry, FAbilitySystemSaveData::StaticStruct(), &Record.AbilitySystemSaveData))
 	{
-		CreateSaveGameDataObject();
-		UE_LOG(LogSaveSystem, Display, TEXT("Created new SaveGameData object"));
+		UE_LOG(LogSaveSystem, Warning, TEXT("Failed to read the record of player %s"), *PlayerId);
+		return false;
 	}
+
+	ApplyPlayerRecord(PlayerState, Record);
+	return true;
 }
 
-void USaveGameSubsystem::LoadPlayerAbilitySystemState()
+void USaveGameSubsystem::ApplyPlayerRecord(APlayerState* PlayerState, const FPlayerSaveRecord& Record)
 {
-	UAbilitySystemComponent* ASC = FindPlayerAbilitySystemComponent();
-
-	if (!ASC)
+	APawn* Pawn = PlayerState->GetPawn();
+	if (Pawn && Record.PlayerStateSaveData.bResumeAtTransform)
 	{
-		return;
-	}
+		Pawn->SetActorTransform(Record.PlayerStateSaveData.Transform);
 
-	const TArray<UAttributeSet*>& AttrSets = ASC->GetSpawnedAttributes();
-	for (UAttributeSet* AttrSet : AttrSets)
-	{
-		for (TFieldIterator<FProperty> It(AttrSet->GetClass(), EFieldIterationFlags::IncludeSuper); It; ++It)
+		AController* Controller = PlayerState->GetOwningController();
+		if (Controller && Settings->bSetControllerRotationAfterLoadingPlayerState)
 		{
-			FProperty* Property = *It;
-
-			if (!FGameplayAttribute::IsGameplayAttributeDataProperty(Property))
-			{
-				continue;
-			}
-
-			if (FAttributeSaveData* AttrSaveData = CurrentSaveGame->SavedAttributes.Find(GetAttributeName(Property)))
-			{
-				FGameplayAttributeData* DataPtr = GetAttributeData(Property, AttrSet);
-				DataPtr->SetBaseValue(AttrSaveData->BaseValue);
-				DataPtr->SetCurrentValue(AttrSaveData->BaseValue);
-			}
+			Controller->SetControlRotation(Record.PlayerStateSaveData.Transform.Rotator());
 		}
 	}
 
-	for (const FGameplayAbilitySaveData& AbilityData : CurrentSaveGame->SavedPlayerAbilities)
+	if (UAbilitySystemComponent* ASC = FindAbilitySystemComponent(PlayerState))
 	{
-		UGameplayAbility* AbilityCDO = AbilityData.AbilityClass->GetDefaultObject<UGameplayAbility>();
-
-		FGameplayAbilitySpec AbilitySpec(AbilityCDO, AbilityData.Level);
-		AbilitySpec.DynamicAbilityTags = AbilityData.DynamicTags;
-
-		ASC->GiveAbility(AbilitySpec);
-		ISavableObjectInterface::Execute_OnObjectLoaded(AbilityCDO);
+		ApplyAbilitySystem(ASC, Record.AbilitySystemSaveData);
 	}
-	
-	for (const FGameplayEffectSaveData& EffectData : CurrentSaveGame->SavedGameplayEffects)
+}
+
+FString USaveGameSubsystem::GetPlayerSaveId(const APlayerState* PlayerState)
+{
+	if (!PlayerState)
 	{
-		UGameplayEffect* GameplayEffectCDO = EffectData.EffectClass->GetDefaultObject<UGameplayEffect>();
-		ASC->ApplyGameplayEffectToSelf(GameplayEffectCDO, EffectData.Level, ASC->MakeEffectContext());
-		ISavableObjectInterface::Execute_OnObjectLoaded(GameplayEffectCDO);
+		return FString();
 	}
+
+	const FUniqueNetIdRepl& UniqueId = PlayerState->GetUniqueId();
+	return UniqueId.IsValid() ? UniqueId.ToString() : FString();
 }
 
-const TArray<USaveGameMetadata*>& USaveGameSubsystem::LoadAllSaveGameMetadata()
+void USaveGameSubsystem::CapturePlayerRecord(APlayerState* PlayerState, FPlayerSaveRecord& OutRecord) const
 {
-	LoadedMetadata.Empty();
-	
-	if (!Settings->bCreateMetadata)
+	OutRecord.PlayerId = GetPlayerSaveId(PlayerState);
+
+	if (const APawn* Pawn = PlayerState->GetPawn())
 	{
-		return LoadedMetadata; // Empty array
+		OutRecord.PlayerStateSaveData.Transform = Pawn->GetTransform();
+		OutRecord.PlayerStateSaveData.bResumeAtTransform = true;
 	}
-	
-	TArray<FString> MetadataPaths;
-	FString Extension = "*.json";
-	IFileManager& FileManager = IFileManager::Get();
-	FileManager.FindFilesRecursive(MetadataPaths, *GetSaveDirectory(), *Extension, true, false);
 
-	for (const FString& Path : MetadataPaths)
+	if (UAbilitySystemComponent* ASC = FindAbilitySystemComponent(PlayerState))
 	{
-		if (USaveGameMetadata* Metadata = ReadMetadata(Path))
-		{
-			LoadedMetadata.Add(Metadata);
-		}
+		CaptureAbilitySystem(ASC, OutRecord.AbilitySystemSaveData);
 	}
+}
 
-	return LoadedMetadata;
+bool USaveGameSubsystem::WritePlayerRecordToDisk(const FPlayerSaveRecord& Record, const FString& Filename,
+	ESaveCompressionFormat CompressionFormat, ESaveCompressionLevel CompressionLevel)
+{
+	SAVESYSTEM_PHASE_SCOPE(WritePlayerRecord);
+
+	// Same chunks as the player sections of a full save
+	TArray<FSaveGameChunk> Chunks;
+	Chunks.Reserve(2);
+
+	FSaveGameChunk& PlayerChunk = Chunks.Add_GetRef({ESaveGameChunkType::Player});
+	FSaveGameContainer::SerializeStruct(FPlayerStateSaveData::StaticStruct(), &Record.PlayerStateSaveData, PlayerChunk.Data);
+
+	FSaveGameChunk& AbilitySystemChunk = Chunks.Add_GetRef({ESaveGameChunkType::AbilitySystem});
+	FSaveGameContainer::SerializeStruct(FAbilitySystemSaveData::StaticStruct(), &Record.AbilitySystemSaveData, AbilitySystemChunk.Data);
+
+	return FSaveGameContainer::Write(Filename, Chunks, CompressionFormat, CompressionLevel);
 }
 
 UAbilitySystemComponent* USaveGameSubsystem::FindPlayerAbilitySystemComponent() const
 {
-	APlayerState* PlayerState = UGameplayStatics::GetPlayerState(GetWorld(), 0);
+	return FindAbilitySystemComponent(UGameplayStatics::GetPlayerState(GetWorld(), 0));
+}
+
+UAbilitySystemComponent* USaveGameSubsystem::FindAbilitySystemComponent(const APlayerState* PlayerState) const
+{
+	if (!PlayerState)
+	{
+		return nullptr;
+	}
 	
 	if (UAbilitySystemComponent* ASC = PlayerState->FindComponentByClass<UAbilitySystemComponent>())
 	{
 		return ASC;
 	}
 
-	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(GetWorld(), 0);
-	if (UAbilitySystemComponent* ASC = PlayerPawn->FindComponentByClass<UAbilitySystemComponent>())
+	if (const APawn* PlayerPawn = PlayerState->GetPawn())
 	{
-		return ASC;
+		return PlayerPawn->FindComponentByClass<UAbilitySystemComponent>();
 	}
 
 	return nullptr;
 }
 
+void USaveGameSubsystem::MarkSaveDirty(UObject* Object, bool bTransformOnly)
+{
+	if (bTransformOnly)
+	{
+		ISavableObjectInterface::MarkSaveTransformDirty(Object);
+	}
+	else
+	{
+		ISavableObjectInterface::MarkSaveDirty(Object);
+	}
+}
+
 void USaveGameSubsystem::OverrideSpawnTransform()
 {
 	if (!ensure(CurrentSaveGame))
@@ -419,20 +2051,39 @@ void USaveGameSubsystem::OverrideSpawnTransform()
 	}
 }
 
-void USaveGameSubsystem::HandleScreenshotTaken(const TArray<uint8>& ScreenshotBytes)
+bool USaveGameSubsystem::HandleScreenshotTimeout(float DeltaTime)
 {
-	UE_LOG(LogSaveSystem, Display, TEXT("Screenshot bytes: %d"), ScreenshotBytes.Num())
-	
-	FFileHelper::SaveArrayToFile(ScreenshotBytes, *GetScreenshotFilename());
+	ScreenshotTimeoutTickerHandle.Reset();
+	StartNextWrite();
+	return false;
 }
 
-void USaveGameSubsystem::SaveMetadata()
+void USaveGameSubsystem::HandleScreenshotTaken(const FString& Filename, bool bSuccess)
 {
-	if (!Settings->bCreateMetadata)
+	// Screenshots of single file slots are handed to the write request that waits for them
+	if (Filename.IsEmpty())
 	{
+		UE_CLOG(!bSuccess, LogSaveSystem, Error, TEXT("Failed to capture screenshot for the save file."));
+		StartNextWrite();
 		return;
 	}
 	
+	if (!bSuccess)
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to write screenshot to file %s."), *Filename);
+		return;
+	}
+
+	UE_LOG(LogSaveSystem, Display, TEXT("Wrote screenshot to file %s"), *Filename);
+
+	if (ThumbnailCache)
+	{
+		ThumbnailCache->Invalidate(Filename);
+	}
+}
+
+bool USaveGameSubsystem::SerializeMetadata(FString& OutJsonString) const
+{
 	MetadataCDO->InitMetadata();
 
 	TSharedRef<FJsonObject> JsonObject(new FJsonObject());
@@ -440,23 +2091,19 @@ void USaveGameSubsystem::SaveMetadata()
 	if (!FJsonObjectConverter::UStructToJsonObject(MetadataCDO->GetClass(), MetadataCDO, JsonObject))
 	{
 		UE_LOG(LogSaveSystem, Error, TEXT("Failed to convert metadata to json object."));
-		return;
+		return false;
 	}
 
-	FString JsonString;
-	if (!FJsonSerializer::Serialize(JsonObject, TJsonWriterFactory<>::Create(&JsonString, 0)))
+	if (!FJsonSerializer::Serialize(JsonObject, TJsonWriterFactory<>::Create(&OutJsonString, 0)))
 	{
 		UE_LOG(LogSaveSystem, Error, TEXT("Failed to serialize json object to string."));
-		return;
+		return false;
 	}
 
-	if (!FFileHelper::SaveStringToFile(JsonString, *CurrentMetadataFilename))
-	{
-		UE_LOG(LogSaveSystem, Error, TEXT("Failed to save json string to file %s."), *CurrentMetadataFilename);
-	}
+	return true;
 }
 
-USaveGameMetadata* USaveGameSubsystem::ReadMetadata(const FString& MetadataPath) const
+USaveGameMetadata* USaveGameSubsystem::ReadMetadata(const FString& MetadataPath, TSharedPtr<const FSaveGameChunkEntry>* OutThumbnailEntry) const
 {
 	if (!Settings->bCreateMetadata)
     {
@@ -464,7 +2111,28 @@ USaveGameMetadata* USaveGameSubsystem::ReadMetadata(const FString& MetadataPath)
     }
 
 	FString JsonString;
-	if (!FFileHelper::LoadFileToString(JsonString, *MetadataPath))
+	if (FPaths::GetExtension(MetadataPath) == TEXT("sav"))
+	{
+		// Slots written before single file slots were enabled keep their metadata in a json file next to the save
+		FSaveGameContainer Container;
+		const FSaveGameChunkEntry* MetadataEntry = Container.Open(MetadataPath) ? Container.FindEntry(ESaveGameChunkType::Metadata) : nullptr;
+
+		TArray<uint8> MetadataBytes;
+		if (!MetadataEntry || !Container.ReadChunk(*MetadataEntry, MetadataBytes))
+		{
+			return ReadMetadata(FPaths::ChangeExtension(MetadataPath, TEXT("json")));
+		}
+
+		// The screenshot is read later from the same table of contents, without opening the file again
+		const FSaveGameChunkEntry* ThumbnailEntry = Container.FindEntry(ESaveGameChunkType::Thumbnail);
+		if (OutThumbnailEntry && ThumbnailEntry)
+		{
+			*OutThumbnailEntry = MakeShared<FSaveGameChunkEntry>(*ThumbnailEntry);
+		}
+		
+		FFileHelper::BufferToString(JsonString, MetadataBytes.GetData(), MetadataBytes.Num());
+	}
+	else if (!FFileHelper::LoadFileToString(JsonString, *MetadataPath))
 	{
 		UE_LOG(LogSaveSystem, Error, TEXT("Failed to read json string from file %s."), *MetadataPath);
 		return nullptr;
@@ -477,41 +2145,31 @@ USaveGameMetadata* USaveGameSubsystem::ReadMetadata(const FString& MetadataPath)
 		return nullptr;
 	}
 
-	USaveGameMetadata* Metadata = NewObject<USaveGameMetadata>();
+	USaveGameMetadata* Metadata = NewObject<USaveGameMetadata>(GetTransientPackage(), MetadataCDO->GetClass());
 	if (!FJsonObjectConverter::JsonObjectToUStruct(JsonObject.ToSharedRef(), Metadata->GetClass(), Metadata))
 	{
 		UE_LOG(LogSaveSystem, Error, TEXT("Failed to convert json object to metadata."));
 		return nullptr;
 	}
 
-	if (Settings->bTakeScreenshot)
-	{
-		Metadata->Screenshot = LoadScreenshot(MetadataPath);
-	}
-
 	return Metadata;
 }
 
-void USaveGameSubsystem::RequestScreenshot() const
+void USaveGameSubsystem::RequestScreenshot()
 {
-	if (CanRequestScreenshot())
+	if (!CanRequestScreenshot())
 	{
-		ScreenshotTaker->RequestScreenshot();
+		return;
 	}
-}
-
-UTexture2D* USaveGameSubsystem::LoadScreenshot(const FString& MetadataPath) const
-{
-	FString ScreenshotPath = FPaths::ChangeExtension(MetadataPath, GetScreenshotFormat());
 
-	TArray<uint8> ScreenshotBytes;
-	if (!FFileHelper::LoadFileToArray(ScreenshotBytes, *ScreenshotPath))
+	if (Settings->bSingleFileSlots)
 	{
-		UE_LOG(LogSaveSystem, Error, TEXT("Failed to load screenshot from file %s."), *ScreenshotPath);
-		return nullptr;
+		PendingThumbnail = ScreenshotTaker->RequestScreenshotData();
+	}
+	else
+	{
+		ScreenshotTaker->RequestScreenshot(GetScreenshotFilename());
 	}
-
-	return UKismetRenderingLibrary::ImportBufferAsTexture2D(GetWorld(), ScreenshotBytes);
 }
 
 bool USaveGameSubsystem::CanRequestScreenshot() const
@@ -524,6 +2182,41 @@ FString USaveGameSubsystem::GetSaveDirectory() const
 	return FString::Printf(TEXT("%s/SaveGames"), *UKismetSystemLibrary::GetProjectSavedDirectory());
 }
 
+FString USaveGameSubsystem::GetMetadataIndexFilename() const
+{
+	return FString::Printf(TEXT("%s/SaveGameMetadata.idx"), *GetSaveDirectory());
+}
+
+FString USaveGameSubsystem::GetSaveFilename(const FString& SlotName) const
+{
+	return FString::Printf(TEXT("%s/%s.sav"), *GetSaveDirectory(), *SlotName);
+}
+
+FString USaveGameSubsystem::GetPlayerSaveFilename(const FString& PlayerId) const
+{
+	return FString::Printf(TEXT("%s/%s/%s.sav"), *GetSaveDirectory(), PlayersDirectory, *FPaths::MakeValidFileName(PlayerId, TEXT('_')));
+}
+
+FString USaveGameSubsystem::GetJournalFilename(const FString& SlotName) const
+{
+	return FString::Printf(TEXT("%s/%s.journal"), *GetSaveDirectory(), *SlotName);
+}
+
+bool USaveGameSubsystem::IsJournalSlot(const FString& SlotName) const
+{
+	return Settings->bEnableAutosave && Settings->bJournaledAutosave && SlotName == GetFullSlotName(Settings->DefaultAutosaveName);
+}
+
+FString USaveGameSubsystem::GetFullSlotName(const FString& SlotName) const
+{
+	if (Settings->bCreateSeparateFolderForSave)
+	{
+		return FString::Printf(TEXT("%s/%s"), *SlotName, *SlotName);
+	}
+
+	return SlotName;
+}
+
 FString USaveGameSubsystem::GetScreenshotFilename() const
 {
 	return FString::Printf(TEXT("%s/%s.%s"), *GetSaveDirectory(), *CurrentSlotName, *GetScreenshotFormat());
@@ -534,6 +2227,12 @@ FString USaveGameSubsystem::GetScreenshotFormat() const
 	return UEnum::GetDisplayValueAsText(ScreenshotTaker->GetScreenshotFormat()).ToString().ToLower();
 }
 
+FString USaveGameSubsystem::GetThumbnailFilename(const FString& MetadataPath) const
+{
+	// Single file slots keep the screenshot in the save file that also holds the metadata
+	return Settings->bSingleFileSlots ? MetadataPath : FPaths::ChangeExtension(MetadataPath, GetScreenshotFormat());
+}
+
 FString USaveGameSubsystem::GetAttributeName(const FProperty* Property) const
 {
 	return FString::Printf(TEXT("%s.%s"), *Property->GetOwnerVariant().GetName(), *Property->GetName());
@@ -541,6 +2240,11 @@ FString USaveGameSubsystem::GetAttributeName(const FProperty* Property) const
 
 FString USaveGameSubsystem::GetAutosaveSlotName()
 {
+	if (Settings->bJournaledAutosave)
+	{
+		return Settings->DefaultAutosaveName;
+	}
+	
 	return FString::Printf(TEXT("%s%02d"), *Settings->DefaultAutosaveName, GetAutosaveIndex());
 }
 
@@ -571,10 +2275,21 @@ APlayerState* USaveGameSubsystem::GetPlayerState() const
 	return PlayerState;
 }
 
+USavableActorRegistry* USaveGameSubsystem::GetSavableActorRegistry() const
+{
+	const UWorld* World = GetWorld();
+	return World ? World->GetSubsystem<USavableActorRegistry>() : nullptr;
+}
+
 void USaveGameSubsystem::CreateSaveGameDataObject()
 {
 	if (!CurrentSaveGame)
 	{
-		CurrentSaveGame = CastChecked<USaveGameData>(UGameplayStatics::CreateSaveGameObject(USaveGameData::StaticClass()));
+		CurrentSaveGame = NewSaveGameDataObject();
 	}
 }
+
+USaveGameData* USaveGameSubsystem::NewSaveGameDataObject() const
+{
+	return CastChecked<USaveGameData>(UGameplayStatics::CreateSaveGameObject(USaveGameData::StaticClass()));
+}
@@ -0,0 +1,205 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SavePropertyPlan.h"
+#include "SaveSystemLogChannels.h"
+
+#include "Serialization/StructuredArchive.h"
+
+const FSavePropertyPlan& FSavePropertyPlan::Get(const UClass* Class)
+{
+	check(IsInGameThread());
+
+	// Plans are never freed, so workers can keep using them while the game thread adds others
+	static TMap<FObjectKey, TUniquePtr<FSavePropertyPlan>> Plans;
+
+	TUniquePtr<FSavePropertyPlan>& Plan = Plans.FindOrAdd(FObjectKey(Class));
+	if (!Plan)
+	{
+		Plan.Reset(new FSavePropertyPlan(Class));
+	}
+
+	return *Plan;
+}
+
+FSavePropertyPlan::FSavePropertyPlan(const UClass* Class)
+{
+	// Same properties that tagged serialization writes for a save game archive
+	constexpr EPropertyFlags SkippedFlags = CPF_Deprecated | CPF_Transient | CPF_SkipSerialization;
+
+	for (TFieldIterator<FProperty> It(Class, EFieldIterationFlags::IncludeSuper); It; ++It)
+	{
+		FProperty* Property = *It;
+		if (!Property->HasAnyPropertyFlags(CPF_SaveGame) || Property->HasAnyPropertyFlags(SkippedFlags))
+		{
+			continue;
+		}
+
+		FString ExtendedType;
+		const FString Type = Property->GetCPPType(&ExtendedType);
+
+		EntryIndices.Add(Property->GetFName(), Entries.Num());
+		const FEntry& Entry = Entries.Add_GetRef({Property, Property->GetOffset_ForInternal(), Property->GetElementSize(), Property->ArrayDim,
+			Property->GetFName(), FName(Type + ExtendedType)});
+
+		// Hashed as strings, FName hashes are not stable between sessions
+		Schema.Names.Add(Entry.Name);
+		Schema.Types.Add(Entry.Type);
+		Schema.Hash = FCrc::StrCrc32(*Entry.Name.ToString(), Schema.Hash);
+		Schema.Hash = FCrc::StrCrc32(*Entry.Type.ToString(), Schema.Hash);
+	}
+}
+
+const FSavePropertyPlan::FEntry* FSavePropertyPlan::FindEntry(FName Name, FName Type) const
+{
+	const int32* EntryIndex = EntryIndices.Find(Name);
+	return EntryIndex && Entries[*EntryIndex].Type == Type ? &Entries[*EntryIndex] : nullptr;
+}
+
+void FSavePropertyPlan::Serialize(FArchive& Ar, UObject* Object) const
+{
+	// Layout: Num | (Name | Type | Size | Value)...
+	if (Ar.IsSaving())
+	{
+		int32 Num = Entries.Num();
+		Ar << Num;
+
+		for (const FEntry& Entry : Entries)
+		{
+			FName Name = Entry.Name;
+			FName Type = Entry.Type;
+			Ar << Name << Type;
+
+			// Patched once the size of the value is known
+			const int64 SizeOffset = Ar.Tell();
+			int32 Size = 0;
+			Ar << Size;
+
+			SerializeValue(Ar, Entry, Object);
+
+			const int64 EndOffset = Ar.Tell();
+			Size = static_cast<int32>(EndOffset - SizeOffset - sizeof(int32));
+			Ar.Seek(SizeOffset);
+			Ar << Size;
+			Ar.Seek(EndOffset);
+		}
+		return;
+	}
+
+	int32 Num = 0;
+	Ar << Num;
+
+	for (int32 Index = 0; Index != Num && !Ar.IsError(); ++Index)
+	{
+		FName Name;
+		FName Type;
+		int32 Size = 0;
+		Ar << Name << Type << Size;
+
+		const int64 ValueOffset = Ar.Tell();
+		const FEntry* Entry = FindEntry(Name, Type);
+		if (Entry)
+		{
+			SerializeValue(Ar, *Entry, Object);
+		}
+		else
+		{
+			UE_LOG(LogSaveSystem, Verbose, TEXT("Skipped saved property %s of %s, the class no longer has it with type %s"),
+				*Name.ToString(), *Object->GetName(), *Type.ToString());
+		}
+
+		if (Ar.Tell() != ValueOffset + Size)
+		{
+			UE_CLOG(Entry != nullptr, LogSaveSystem, Warning, TEXT("Saved property %s of %s was not read completely"), *Name.ToString(), *Object->GetName());
+			Ar.Seek(ValueOffset + Size);
+		}
+	}
+}
+
+void FSavePropertyPlan::SaveUnversioned(FArchive& Ar, UObject* Object) const
+{
+	TArray<int32, TInlineAllocator<64>> Sizes;
+	Sizes.Reserve(Entries.Num());
+
+	for (const FEntry& Entry : Entries)
+	{
+		const int64 ValueOffset = Ar.Tell();
+		SerializeValue(Ar, Entry, Object);
+		Sizes.Add(static_cast<int32>(Ar.Tell() - ValueOffset));
+	}
+
+	for (int32& Size : Sizes)
+	{
+		Ar << Size;
+	}
+}
+
+void FSavePropertyPlan::LoadUnversioned(FArchive& Ar, UObject* Object, const FSavePropertySchema& SavedSchema, bool bSchemaMatches) const
+{
+	if (bSchemaMatches)
+	{
+		for (const FEntry& Entry : Entries)
+		{
+			SerializeValue(Ar, Entry, Object);
+		}
+		return;
+	}
+
+	const int32 NumValues = SavedSchema.Names.Num();
+	if (SavedSchema.Types.Num() != NumValues)
+	{
+		UE_LOG(LogSaveSystem, Warning, TEXT("Saved property schema of %s is malformed"), *Object->GetName());
+		Ar.SetError();
+		return;
+	}
+
+	// The class changed since the save, the trailing sizes let values without a matching property be skipped
+	const int64 SizesOffset = Ar.TotalSize() - NumValues * static_cast<int64>(sizeof(int32));
+	if (SizesOffset < Ar.Tell())
+	{
+		UE_LOG(LogSaveSystem, Warning, TEXT("Saved properties of %s are truncated"), *Object->GetName());
+		Ar.SetError();
+		return;
+	}
+
+	TArray<int32, TInlineAllocator<64>> Sizes;
+	Sizes.SetNumUninitialized(NumValues);
+
+	const int64 ValuesOffset = Ar.Tell();
+	Ar.Seek(SizesOffset);
+	for (int32& Size : Sizes)
+	{
+		Ar << Size;
+	}
+	Ar.Seek(ValuesOffset);
+
+	int64 ValueOffset = ValuesOffset;
+	for (int32 Index = 0; Index != NumValues && !Ar.IsError(); ++Index)
+	{
+		if (const FEntry* Entry = FindEntry(SavedSchema.Names[Index], SavedSchema.Types[Index]))
+		{
+			SerializeValue(Ar, *Entry, Object);
+			UE_CLOG(Ar.Tell() != ValueOffset + Sizes[Index], LogSaveSystem, Warning, TEXT("Saved property %s of %s was not read completely"),
+				*Entry->Name.ToString(), *Object->GetName());
+		}
+		else
+		{
+			UE_LOG(LogSaveSystem, Verbose, TEXT("Skipped saved property %s of %s, the class no longer has it with type %s"),
+				*SavedSchema.Names[Index].ToString(), *Object->GetName(), *SavedSchema.Types[Index].ToString());
+		}
+
+		ValueOffset += Sizes[Index];
+		Ar.Seek(ValueOffset);
+	}
+}
+
+void FSavePropertyPlan::SerializeValue(FArchive& Ar, const FEntry& Entry, UObject* Object) const
+{
+	uint8* Value = reinterpret_cast<uint8*>(Object) + Entry.Offset;
+
+	FStructuredArchiveFromArchive Adapter(Ar);
+	FStructuredArchive::FStream Stream = Adapter.GetSlot().EnterStream();
+	for (int32 ArrayIndex = 0; ArrayIndex != Entry.ArrayDim; ++ArrayIndex)
+	{
+		Entry.Property->SerializeItem(Stream.EnterElement(), Value + ArrayIndex * Entry.ElementSize, nullptr);
+	}
+}
@@ -14,12 +14,23 @@ USaveSystemSettings::USaveSystemSettings(const FObjectInitializer& Initializer)
 	
 	DefaultSaveSlotName = "SaveGame01";
 	bCreateSeparateFolderForSave = true;
+	bSingleFileSlots = false;
 	
 	bEnableAutosave = true;
 	DefaultAutosaveName = "Autosave";
 	AutosavePeriod = 120.0f;
 	MaxAutosaveNum = 5;
 	AutosaveConditionClass = UAutosaveCondition::StaticClass();
+	bJournaledAutosave = false;
+	AutosaveJournalMaxKilobytes = 4096;
+	AutosaveRetryDelay = 1.0f;
+	AutosaveRetryBackoff = 2.0f;
+	AutosaveMaxRetryDelay = 10.0f;
+	AutosaveFrameTimeBudget = 0.0f;
+	AutosaveMaxHeadroomDeferral = 5.0f;
+	
+	SaveCompressionFormat = ESaveCompressionFormat::Fast;
+	SaveCompressionLevel = ESaveCompressionLevel::Normal;
 	
 	bCreateMetadata = true;
 	MetadataClass = USaveGameMetadata::StaticClass();
@@ -30,6 +41,18 @@ USaveSystemSettings::USaveSystemSettings(const FObjectInitializer& Initializer)
 	bUseCustomScreenshotDimensions = false;
 	Width = 228;
 	Height = 128;
+	ScreenshotCacheMaxCount = 16;
+	ScreenshotCacheMaxMegabytes = 32;
+	ScreenshotTimeoutSeconds = 1.0f;
 
 	bSetControllerRotationAfterLoadingPlayerState = true;
+
+	bParallelActorCapture = false;
+	ParallelCaptureMinActors = 64;
+	bUseSavePropertyPlans = false;
+	bUnversionedPropertyPlans = false;
+	bBatchAbilitySystemRestore = false;
+	bSkipUnchangedSaves = false;
+
+	PlayerSavesPerFrame = 4;
 }
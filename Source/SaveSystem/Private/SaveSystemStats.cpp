@@ -0,0 +1,158 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveSystemStats.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_STAT(STAT_SaveSystem_SaveGameState);
+DEFINE_STAT(STAT_SaveSystem_SaveWorldState);
+DEFINE_STAT(STAT_SaveSystem_CaptureLevelActors);
+DEFINE_STAT(STAT_SaveSystem_SaveAbilitySystemState);
+DEFINE_STAT(STAT_SaveSystem_SavePlayerState);
+DEFINE_STAT(STAT_SaveSystem_SaveMetadata);
+DEFINE_STAT(STAT_SaveSystem_SerializeSaveGame);
+DEFINE_STAT(STAT_SaveSystem_CompressChunks);
+DEFINE_STAT(STAT_SaveSystem_WriteSaveFile);
+DEFINE_STAT(STAT_SaveSystem_AppendJournal);
+DEFINE_STAT(STAT_SaveSystem_CaptureScreenshot);
+DEFINE_STAT(STAT_SaveSystem_EncodeScreenshot);
+DEFINE_STAT(STAT_SaveSystem_LoadSaveGame);
+DEFINE_STAT(STAT_SaveSystem_ReadSaveFile);
+DEFINE_STAT(STAT_SaveSystem_ApplyLevelState);
+DEFINE_STAT(STAT_SaveSystem_LoadAbilitySystemState);
+DEFINE_STAT(STAT_SaveSystem_LoadAllMetadata);
+DEFINE_STAT(STAT_SaveSystem_CapturePlayerRecords);
+DEFINE_STAT(STAT_SaveSystem_WritePlayerRecord);
+DEFINE_STAT(STAT_SaveSystem_LoadPlayerRecord);
+DEFINE_STAT(STAT_SaveSystem_HashSections);
+
+namespace
+{
+	// Upper bounds of the histogram buckets in milliseconds, the last bucket is open
+	constexpr float BucketLimits[] = {0.1f, 0.5f, 1.0f, 5.0f, 10.0f, 50.0f, 100.0f, 500.0f};
+}
+
+FSaveSystemStats& FSaveSystemStats::Get()
+{
+	static FSaveSystemStats Stats;
+	return Stats;
+}
+
+void FSaveSystemStats::RecordPhase(FName Phase, double Seconds)
+{
+	FScopeLock ScopeLock(&Lock);
+	Phases.FindOrAdd(Phase).Add(Seconds);
+}
+
+void FSaveSystemStats::RecordLevelCapture(const FString& LevelKey, double Seconds, int64 Bytes, int32 NumActors)
+{
+	FScopeLock ScopeLock(&Lock);
+	FLevelStats& LevelStats = Levels.FindOrAdd(LevelKey);
+	LevelStats.Capture.Add(Seconds);
+	LevelStats.Bytes = Bytes;
+	LevelStats.NumActors = NumActors;
+}
+
+void FSaveSystemStats::RecordLevelApply(const FString& LevelKey, double Seconds)
+{
+	FScopeLock ScopeLock(&Lock);
+	Levels.FindOrAdd(LevelKey).Apply.Add(Seconds);
+}
+
+void FSaveSystemStats::Dump(FOutputDevice& Ar) const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	FString Buckets;
+	for (float Limit : BucketLimits)
+	{
+		Buckets += FString::Printf(TEXT(" <%g"), Limit);
+	}
+	Ar.Logf(TEXT("Save system phases, last %d samples each, buckets in ms:%s >=%g"), FRollingHistogram::MaxSamples, *Buckets, BucketLimits[UE_ARRAY_COUNT(BucketLimits) - 1]);
+
+	for (const TPair<FName, FRollingHistogram>& Pair : Phases)
+	{
+		Ar.Logf(TEXT("  %-28s %s"), *Pair.Key.ToString(), *Pair.Value.ToString());
+	}
+
+	Ar.Logf(TEXT("Levels, bytes and actors of the last capture:"));
+	for (const TPair<FString, FLevelStats>& Pair : Levels)
+	{
+		Ar.Logf(TEXT("  %s: %lld bytes, %d actors"), *Pair.Key, Pair.Value.Bytes, Pair.Value.NumActors);
+		Ar.Logf(TEXT("    Capture %s"), *Pair.Value.Capture.ToString());
+		Ar.Logf(TEXT("    Apply   %s"), *Pair.Value.Apply.ToString());
+	}
+}
+
+void FSaveSystemStats::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	Phases.Reset();
+	Levels.Reset();
+}
+
+void FSaveSystemStats::FRollingHistogram::Add(double Seconds)
+{
+	if (Samples.Num() < MaxSamples)
+	{
+		Samples.Add(static_cast<float>(Seconds));
+	}
+	else
+	{
+		Samples[NextSample] = static_cast<float>(Seconds);
+	}
+
+	NextSample = (NextSample + 1) % MaxSamples;
+	++NumRecorded;
+}
+
+FString FSaveSystemStats::FRollingHistogram::ToString() const
+{
+	if (Samples.IsEmpty())
+	{
+		return TEXT("no samples");
+	}
+
+	TArray<float> Sorted = Samples;
+	Sorted.Sort();
+
+	int32 Counts[UE_ARRAY_COUNT(BucketLimits) + 1] = {};
+	for (float Seconds : Sorted)
+	{
+		int32 Bucket = 0;
+		while (Bucket != UE_ARRAY_COUNT(BucketLimits) && Seconds * 1000.0f >= BucketLimits[Bucket])
+		{
+			++Bucket;
+		}
+		++Counts[Bucket];
+	}
+
+	FString Histogram;
+	for (int32 Count : Counts)
+	{
+		Histogram += FString::Printf(TEXT(" %d"), Count);
+	}
+
+	auto Percentile = [&Sorted](float Fraction)
+	{
+		return Sorted[FMath::Min(Sorted.Num() - 1, FMath::FloorToInt32(Fraction * Sorted.Num()))] * 1000.0f;
+	};
+
+	return FString::Printf(TEXT("n=%lld min %.3f p50 %.3f p90 %.3f max %.3f ms |%s"),
+		NumRecorded, Sorted[0] * 1000.0f, Percentile(0.5f), Percentile(0.9f), Sorted.Last() * 1000.0f, *Histogram);
+}
+
+static FAutoConsoleCommand StatsCommand(
+	TEXT("SaveSystem.Stats"),
+	TEXT("Prints rolling timing histograms of the save and load phases and the bytes and actors of every level. SaveSystem.Stats reset clears them."),
+	FConsoleCommandWithArgsAndOutputDeviceDelegate::CreateLambda([](const TArray<FString>& Args, FOutputDevice& Ar)
+	{
+		if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		{
+			FSaveSystemStats::Get().Reset();
+			return;
+		}
+
+		FSaveSystemStats::Get().Dump(Ar);
+	}));
@@ -0,0 +1,111 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "HAL/CriticalSection.h"
+
+DECLARE_STATS_GROUP(TEXT("SaveSystem"), STATGROUP_SaveSystem, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save Game State"), STAT_SaveSystem_SaveGameState, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save World State"), STAT_SaveSystem_SaveWorldState, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture Level Actors"), STAT_SaveSystem_CaptureLevelActors, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save Ability System State"), STAT_SaveSystem_SaveAbilitySystemState, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save Player State"), STAT_SaveSystem_SavePlayerState, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save Metadata"), STAT_SaveSystem_SaveMetadata, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Serialize Save Game"), STAT_SaveSystem_SerializeSaveGame, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compress Chunks"), STAT_SaveSystem_CompressChunks, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write Save File"), STAT_SaveSystem_WriteSaveFile, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Append Journal"), STAT_SaveSystem_AppendJournal, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture Screenshot"), STAT_SaveSystem_CaptureScreenshot, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Encode Screenshot"), STAT_SaveSystem_EncodeScreenshot, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Save Game"), STAT_SaveSystem_LoadSaveGame, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Read Save File"), STAT_SaveSystem_ReadSaveFile, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Level State"), STAT_SaveSystem_ApplyLevelState, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Ability System State"), STAT_SaveSystem_LoadAbilitySystemState, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load All Metadata"), STAT_SaveSystem_LoadAllMetadata, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture Player Records"), STAT_SaveSystem_CapturePlayerRecords, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write Player Record"), STAT_SaveSystem_WritePlayerRecord, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Player Record"), STAT_SaveSystem_LoadPlayerRecord, STATGROUP_SaveSystem, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hash Sections"), STAT_SaveSystem_HashSections, STATGROUP_SaveSystem, );
+
+/**
+ * Rolling timings of the save and load phases and the sizes of the saved levels, printed by SaveSystem.Stats.
+ * All functions are thread safe.
+ */
+class FSaveSystemStats
+{
+public:
+	static FSaveSystemStats& Get();
+
+	void RecordPhase(FName Phase, double Seconds);
+	void RecordLevelCapture(const FString& LevelKey, double Seconds, int64 Bytes, int32 NumActors);
+	void RecordLevelApply(const FString& LevelKey, double Seconds);
+
+	void Dump(FOutputDevice& Ar) const;
+	void Reset();
+
+private:
+	/** The most recent samples of a timing, bucketed when printed. */
+	struct FRollingHistogram
+	{
+		static constexpr int32 MaxSamples = 64;
+
+		TArray<float> Samples;
+		int32 NextSample{0};
+		int64 NumRecorded{0};
+
+		void Add(double Seconds);
+		FString ToString() const;
+	};
+
+	struct FLevelStats
+	{
+		FRollingHistogram Capture;
+		FRollingHistogram Apply;
+		int64 Bytes{0};
+		int32 NumActors{0};
+	};
+
+	mutable FCriticalSection Lock;
+	TMap<FName, FRollingHistogram> Phases;
+	TMap<FString, FLevelStats> Levels;
+};
+
+/** Records the time until the end of the scope as a phase, optionally also into OutSeconds. */
+class FSaveSystemPhaseScope
+{
+public:
+	explicit FSaveSystemPhaseScope(FName InPhase, float* InOutSeconds = nullptr)
+		: Phase(InPhase)
+		, OutSeconds(InOutSeconds)
+		, StartTime(FPlatformTime::Seconds())
+	{
+	}
+
+	~FSaveSystemPhaseScope()
+	{
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		FSaveSystemStats::Get().RecordPhase(Phase, Seconds);
+		if (OutSeconds)
+		{
+			*OutSeconds = static_cast<float>(Seconds);
+		}
+	}
+
+private:
+	FName Phase;
+	float* OutSeconds;
+	double StartTime;
+};
+
+/** Trace event, cycle stat and rolling timing of a phase, e.g. SAVESYSTEM_PHASE_SCOPE(SaveWorldState). */
+#define SAVESYSTEM_PHASE_SCOPE(Name) SAVESYSTEM_PHASE_SCOPE_SECONDS(Name, nullptr)
+
+#define SAVESYSTEM_PHASE_SCOPE_SECONDS(Name, OutSeconds) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(SaveSystem_##Name); \
+	SCOPE_CYCLE_COUNTER(STAT_SaveSystem_##Name); \
+	static const FName SaveSystemPhaseName_##Name(TEXT(#Name)); \
+	FSaveSystemPhaseScope SaveSystemPhaseScope_##Name(SaveSystemPhaseName_##Name, OutSeconds)
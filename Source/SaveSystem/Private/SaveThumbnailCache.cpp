@@ -0,0 +1,217 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveThumbnailCache.h"
+#include "SaveGameMetadata.h"
+#include "SaveSystemLogChannels.h"
+#include "SaveGameContainer.h"
+
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SaveThumbnailCache)
+
+void USaveThumbnailCache::Configure(int32 InMaxCount, int64 InMaxBytes)
+{
+	MaxCount = InMaxCount;
+	MaxBytes = InMaxBytes;
+	EvictOverBudget();
+}
+
+void USaveThumbnailCache::RequestThumbnail(USaveGameMetadata* Metadata, const FString& Filename, bool bFromSaveFile,
+	TSharedPtr<const FSaveGameChunkEntry> ThumbnailEntry)
+{
+	if (!Metadata)
+	{
+		return;
+	}
+
+	if (FSaveThumbnailCacheEntry* Entry = Entries.Find(Filename))
+	{
+		Entry->Users.AddUnique(Metadata);
+		Touch(Filename);
+		AssignThumbnail(Metadata, Entry->Texture);
+		return;
+	}
+
+	if (TArray<TWeakObjectPtr<USaveGameMetadata>>* Waiting = PendingRequests.Find(Filename))
+	{
+		Waiting->AddUnique(Metadata);
+		return;
+	}
+
+	PendingRequests.Add(Filename).Add(Metadata);
+
+	// The module has to be loaded on the game thread, the decode tasks only use it
+	if (!ImageWrapperModule)
+	{
+		ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	}
+
+	if (!TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::Tick));
+	}
+
+	Async(EAsyncExecution::ThreadPool, [Results = DecodedThumbnails, WrapperModule = ImageWrapperModule, Filename, bFromSaveFile, ThumbnailEntry]
+	{
+		FDecodedThumbnail Result;
+		Result.Filename = Filename;
+
+		TArray<uint8> CompressedBytes;
+		bool bLoaded = false;
+		if (!bFromSaveFile)
+		{
+			bLoaded = FFileHelper::LoadFileToArray(CompressedBytes, *Filename);
+		}
+		else if (ThumbnailEntry)
+		{
+			bLoaded = FSaveGameContainer::ReadChunkFromFile(Filename, *ThumbnailEntry, CompressedBytes);
+		}
+		else
+		{
+			bLoaded = FSaveGameContainer::ReadChunkFromFile(Filename, ESaveGameChunkType::Thumbnail, CompressedBytes);
+		}
+		
+		if (bLoaded)
+		{
+			const EImageFormat ImageFormat = WrapperModule->DetectImageFormat(CompressedBytes.GetData(), CompressedBytes.Num());
+			const TSharedPtr<IImageWrapper> ImageWrapper = WrapperModule->CreateImageWrapper(ImageFormat);
+
+			if (ImageWrapper.IsValid() && ImageWrapper->SetCompressed(CompressedBytes.GetData(), CompressedBytes.Num())
+				&& ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, Result.Pixels))
+			{
+				Result.Width = ImageWrapper->GetWidth();
+				Result.Height = ImageWrapper->GetHeight();
+			}
+		}
+
+		// An empty result still has to reach the game thread to release the waiting requests
+		Results->Enqueue(MoveTemp(Result));
+	});
+}
+
+void USaveThumbnailCache::Invalidate(const FString& Filename)
+{
+	RemoveEntry(Filename);
+}
+
+void USaveThumbnailCache::BeginDestroy()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	TickerHandle.Reset();
+	
+	Super::BeginDestroy();
+}
+
+bool USaveThumbnailCache::Tick(float DeltaTime)
+{
+	FDecodedThumbnail Decoded;
+	while (DecodedThumbnails->Dequeue(Decoded))
+	{
+		TArray<TWeakObjectPtr<USaveGameMetadata>> Waiting;
+		if (!PendingRequests.RemoveAndCopyValue(Decoded.Filename, Waiting))
+		{
+			continue;
+		}
+
+		UTexture2D* Texture = nullptr;
+		if (Decoded.Width > 0 && Decoded.Height > 0)
+		{
+			Texture = UTexture2D::CreateTransient(Decoded.Width, Decoded.Height, PF_B8G8R8A8);
+		}
+
+		if (Texture)
+		{
+			FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+			void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+			FMemory::Memcpy(MipData, Decoded.Pixels.GetData(), Decoded.Pixels.Num());
+			Mip.BulkData.Unlock();
+			Texture->UpdateResource();
+
+			AddEntry(Decoded.Filename, Texture, Decoded.Pixels.Num());
+		}
+		else
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("Failed to load screenshot from file %s."), *Decoded.Filename);
+		}
+
+		for (const TWeakObjectPtr<USaveGameMetadata>& Metadata : Waiting)
+		{
+			if (Metadata.IsValid())
+			{
+				if (Texture)
+				{
+					Entries[Decoded.Filename].Users.AddUnique(Metadata);
+				}
+				AssignThumbnail(Metadata.Get(), Texture);
+			}
+		}
+	}
+
+	if (PendingRequests.IsEmpty())
+	{
+		TickerHandle.Reset();
+		return false;
+	}
+
+	return true;
+}
+
+void USaveThumbnailCache::AddEntry(const FString& Filename, UTexture2D* Texture, int64 Bytes)
+{
+	RemoveEntry(Filename);
+
+	FSaveThumbnailCacheEntry& Entry = Entries.Add(Filename);
+	Entry.Texture = Texture;
+	Entry.Bytes = Bytes;
+	
+	TotalBytes += Bytes;
+	UsageOrder.Add(Filename);
+
+	EvictOverBudget();
+}
+
+void USaveThumbnailCache::Touch(const FString& Filename)
+{
+	UsageOrder.RemoveSingle(Filename);
+	UsageOrder.Add(Filename);
+}
+
+void USaveThumbnailCache::RemoveEntry(const FString& Filename)
+{
+	FSaveThumbnailCacheEntry Entry;
+	if (!Entries.RemoveAndCopyValue(Filename, Entry))
+	{
+		return;
+	}
+
+	UsageOrder.RemoveSingle(Filename);
+	TotalBytes -= Entry.Bytes;
+
+	// Metadata objects must not keep evicted textures alive
+	for (const TWeakObjectPtr<USaveGameMetadata>& Metadata : Entry.Users)
+	{
+		if (Metadata.IsValid() && Metadata->Screenshot == Entry.Texture)
+		{
+			Metadata->Screenshot = nullptr;
+		}
+	}
+}
+
+void USaveThumbnailCache::EvictOverBudget()
+{
+	// The most recently used texture always stays, even if it alone exceeds the budget
+	while (UsageOrder.Num() > 1 && ((MaxCount > 0 && UsageOrder.Num() > MaxCount) || (MaxBytes > 0 && TotalBytes > MaxBytes)))
+	{
+		RemoveEntry(UsageOrder[0]);
+	}
+}
+
+void USaveThumbnailCache::AssignThumbnail(USaveGameMetadata* Metadata, UTexture2D* Texture) const
+{
+	Metadata->Screenshot = Texture;
+	Metadata->OnScreenshotLoaded.Broadcast(Metadata);
+}
@@ -0,0 +1,89 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "Containers/Queue.h"
+#include "Containers/Ticker.h"
+#include "SaveThumbnailCache.generated.h"
+
+class IImageWrapperModule;
+struct FSaveGameChunkEntry;
+class UTexture2D;
+class USaveGameMetadata;
+
+USTRUCT()
+struct FSaveThumbnailCacheEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UTexture2D> Texture;
+
+	// Metadata objects that were handed the texture, released together with it
+	TArray<TWeakObjectPtr<USaveGameMetadata>> Users;
+
+	int64 Bytes{0};
+};
+
+/**
+ * Loads save game screenshots on demand. Reading and decoding the image happens on a worker thread,
+ * the textures of all decodes that finished are created together on the game thread once per frame.
+ * Textures are kept in a least recently used cache bounded by a count and a byte budget.
+ */
+UCLASS()
+class USaveThumbnailCache : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Zero disables the respective limit. */
+	void Configure(int32 InMaxCount, int64 InMaxBytes);
+
+	/**
+	 * Assigns the screenshot to the metadata and broadcasts its OnScreenshotLoaded, immediately on a cache hit.
+	 * With bFromSaveFile, Filename is a save file whose thumbnail chunk holds the image. ThumbnailEntry is that chunk
+	 * if its table of contents has been read already, otherwise the table of contents is read first.
+	 */
+	void RequestThumbnail(USaveGameMetadata* Metadata, const FString& Filename, bool bFromSaveFile = false,
+		TSharedPtr<const FSaveGameChunkEntry> ThumbnailEntry = nullptr);
+
+	/** Drops the cached texture of a file that has been rewritten. */
+	void Invalidate(const FString& Filename);
+
+	virtual void BeginDestroy() override;
+
+protected:
+	struct FDecodedThumbnail
+	{
+		FString Filename;
+		int32 Width{0};
+		int32 Height{0};
+		TArray64<uint8> Pixels;
+	};
+
+	UPROPERTY()
+	TMap<FString, FSaveThumbnailCacheEntry> Entries;
+
+	// Least recently used first
+	TArray<FString> UsageOrder;
+
+	// Files that are being decoded and the metadata objects waiting for them
+	TMap<FString, TArray<TWeakObjectPtr<USaveGameMetadata>>> PendingRequests;
+
+	// Shared with the decode tasks, which may outlive this object
+	TSharedRef<TQueue<FDecodedThumbnail, EQueueMode::Mpsc>> DecodedThumbnails = MakeShared<TQueue<FDecodedThumbnail, EQueueMode::Mpsc>>();
+
+	IImageWrapperModule* ImageWrapperModule{nullptr};
+	FTSTicker::FDelegateHandle TickerHandle;
+	
+	int32 MaxCount{0};
+	int64 MaxBytes{0};
+	int64 TotalBytes{0};
+
+	bool Tick(float DeltaTime);
+	void AddEntry(const FString& Filename, UTexture2D* Texture, int64 Bytes);
+	void Touch(const FString& Filename);
+	void RemoveEntry(const FString& Filename);
+	void EvictOverBudget();
+	void AssignThumbnail(USaveGameMetadata* Metadata, UTexture2D* Texture) const;
+};
@@ -4,9 +4,13 @@
 
 #include "HighResScreenshot.h"
 #include "SaveSystemSettings.h"
+#include "ThumbnailDownsampler.h"
+#include "SaveSystemStats.h"
 
 #include "IImageWrapper.h"
 #include "IImageWrapperModule.h"
+#include "Async/Async.h"
+#include "Misc/FileHelper.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(ScreenshotTaker)
 
@@ -16,62 +20,133 @@ UScreenshotTaker::UScreenshotTaker()
 	
 	CompressionRate = Settings->CompressionRate;
 	ScreenshotFormat = Settings->ScreenshotFormat;
+	ImageWrapperModule = nullptr;
 	bIsScreenshotRequested = false;
 	bUseCustomDimensions = Settings->bUseCustomScreenshotDimensions;
 	Width = Settings->Width;
 	Height = Settings->Height;
 }
 
-void UScreenshotTaker::RequestScreenshot()
+void UScreenshotTaker::RequestScreenshot(const FString& Filename)
 {
-	if (!GEngine || !GEngine->GameViewport || bIsScreenshotRequested)
+	if (BeginCapture())
 	{
-		return;
+		RequestedFilename = Filename;
 	}
+}
 
-	bIsScreenshotRequested = true;
-	GEngine->GameViewport->OnScreenshotCaptured().AddUObject(this, &ThisClass::AcceptScreenshot);
+TSharedFuture<TArray64<uint8>> UScreenshotTaker::RequestScreenshotData()
+{
+	if (!BeginCapture())
+	{
+		return MakeFulfilledPromise<TArray64<uint8>>().GetFuture().Share();
+	}
+
+	RequestedData = MakeShared<TPromise<TArray64<uint8>>>();
+	return RequestedData->GetFuture().Share();
+}
 
-	if (bUseCustomDimensions)
+bool UScreenshotTaker::BeginCapture()
+{
+	if (!GEngine || !GEngine->GameViewport || bIsScreenshotRequested)
+	{
+		return false;
+	}
+
+	// The encode tasks use the module, but it can only be loaded on the game thread
+	if (!ImageWrapperModule)
 	{
-		GetHighResScreenshotConfig().SetResolution(Width, Height, 1.0f);
+		ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
 	}
+
+	bIsScreenshotRequested = true;
+	RequestedFilename.Reset();
+	RequestedData.Reset();
+	GEngine->GameViewport->OnScreenshotCaptured().AddUObject(this, &ThisClass::AcceptScreenshot);
 	
 	FScreenshotRequest::RequestScreenshot(false);
+	return true;
 }
 
 void UScreenshotTaker::AcceptScreenshot(int32 InSizeX, int32 InSizeY, const TArray<FColor>& InImageData)
 {
-	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	SAVESYSTEM_PHASE_SCOPE(CaptureScreenshot);
+
+	GEngine->GameViewport->OnScreenshotCaptured().RemoveAll(this);
+	bIsScreenshotRequested = false;
+
+	// The frame arrives at viewport resolution and is reduced to the thumbnail size before it is encoded
+	const FIntPoint ThumbnailSize = bUseCustomDimensions
+		? FIntPoint(FMath::Min(Width, InSizeX), FMath::Min(Height, InSizeY))
+		: FIntPoint(InSizeX, InSizeY);
+
+	// The viewport owns the captured frame, so this copy is the only one on the game thread
+	TWeakObjectPtr<ThisClass> WeakThis(this);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, WrapperModule = ImageWrapperModule, Format = ScreenshotFormat, Quality = CompressionRate,
+		InSizeX, InSizeY, ThumbnailSize, Pixels = InImageData, Filename = MoveTemp(RequestedFilename), Promise = MoveTemp(RequestedData)]
+	{
+		SAVESYSTEM_PHASE_SCOPE(EncodeScreenshot);
+
+		TArray64<uint8> CompressedImage;
+		bool bSuccess;
+		
+		if (ThumbnailSize != FIntPoint(InSizeX, InSizeY))
+		{
+			TArray<FColor> Thumbnail;
+			bSuccess = FThumbnailDownsampler::Downsample(Pixels, InSizeX, InSizeY, Thumbnail, ThumbnailSize.X, ThumbnailSize.Y)
+				&& EncodeScreenshot(*WrapperModule, Format, Quality, ThumbnailSize.X, ThumbnailSize.Y, Thumbnail, CompressedImage);
+		}
+		else
+		{
+			bSuccess = EncodeScreenshot(*WrapperModule, Format, Quality, InSizeX, InSizeY, Pixels, CompressedImage);
+		}
+
+		// Written straight from the encoder output
+		if (bSuccess && !Filename.IsEmpty())
+		{
+			bSuccess = FFileHelper::SaveArrayToFile(CompressedImage, *Filename);
+		}
+
+		if (Promise.IsValid())
+		{
+			Promise->SetValue(bSuccess ? MoveTemp(CompressedImage) : TArray64<uint8>());
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Filename, bSuccess]
+		{
+			if (ThisClass* This = WeakThis.Get())
+			{
+				This->OnScreenshotTaken.Broadcast(Filename, bSuccess);
+			}
+		});
+	});
+}
+
+bool UScreenshotTaker::EncodeScreenshot(IImageWrapperModule& WrapperModule, EScreenshotFormat Format, int32 Quality,
+	int32 SizeX, int32 SizeY, const TArray<FColor>& Pixels, TArray64<uint8>& OutCompressedImage)
+{
 	TSharedPtr<IImageWrapper> ImageWrapper;
 
-	switch (ScreenshotFormat)
+	switch (Format)
 	{
 	case EScreenshotFormat::JPEG:
-		ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::JPEG);
+		ImageWrapper = WrapperModule.CreateImageWrapper(EImageFormat::JPEG);
 		break;
 	case EScreenshotFormat::PNG:
-		ImageWrapper = ImageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+		ImageWrapper = WrapperModule.CreateImageWrapper(EImageFormat::PNG);
 		break;
 	}
 	
-	if (!ImageWrapper.IsValid())
+	if (!ImageWrapper.IsValid() || Pixels.IsEmpty())
 	{
-		bIsScreenshotRequested = false;
-		return;
+		return false;
 	}
 
-	if (!ImageWrapper->SetRaw(&InImageData[0], InImageData.Num() * sizeof(FColor), InSizeX, InSizeY, ERGBFormat::BGRA, 8))
+	if (!ImageWrapper->SetRaw(Pixels.GetData(), Pixels.Num() * sizeof(FColor), SizeX, SizeY, ERGBFormat::BGRA, 8))
 	{
-		bIsScreenshotRequested = false;
-		return;
+		return false;
 	}
 
-	TArray64<uint8> CompressedImage64 = ImageWrapper->GetCompressed(CompressionRate);
-	CompressedImage64.Shrink();
-	TArray<uint8> CompressedImage(CompressedImage64);
-	OnScreenshotTaken.Broadcast(CompressedImage);
-
-	GEngine->GameViewport->OnScreenshotCaptured().RemoveAll(this);
-	bIsScreenshotRequested = false;
+	OutCompressedImage = ImageWrapper->GetCompressed(Quality);
+	return !OutCompressedImage.IsEmpty();
 }
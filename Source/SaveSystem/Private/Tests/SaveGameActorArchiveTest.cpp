@@ -0,0 +1,180 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "Tests/SaveSystemTests.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "SaveGameActorArchive.h"
+
+#include "Abilities/GameplayAbility.h"
+#include "GameplayEffect.h"
+#include "GameplayTagsManager.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/SoftObjectPtr.h"
+
+namespace
+{
+	// Names, object references and soft references the way a savable actor writes them
+	struct FTestActorPayload
+	{
+		FName Name;
+		UObject* Object{nullptr};
+		UObject* NullObject{nullptr};
+		FSoftObjectPath SoftPath;
+		FSoftObjectPath NullSoftPath;
+		TSoftObjectPtr<UObject> SoftPointer;
+		TSoftClassPtr<UObject> SoftClass;
+		FAbilitySystemSaveData AbilitySystem;
+
+		void Serialize(FArchive& Ar)
+		{
+			Ar << Name;
+			Ar << Object;
+			Ar << NullObject;
+			Ar << SoftPath;
+			Ar << NullSoftPath;
+			Ar << SoftPointer;
+			Ar << SoftClass;
+			FAbilitySystemSaveData::StaticStruct()->SerializeItem(Ar, &AbilitySystem, nullptr);
+		}
+	};
+
+	FTestActorPayload MakePayload(int32 Seed)
+	{
+		// Names, classes and gameplay tags repeated many times, the way actor payloads repeat them
+		FGameplayTagContainer AllTags;
+		UGameplayTagsManager::Get().RequestAllGameplayTags(AllTags, true);
+		const TArray<FGameplayTag> Tags = AllTags.GetGameplayTagArray();
+
+		FTestActorPayload Payload;
+		Payload.Name = FName(TEXT("SavedActor"), Seed + 1);
+		Payload.Object = Seed % 2 ? UGameplayAbility::StaticClass() : UGameplayEffect::StaticClass();
+		Payload.SoftPath = FSoftObjectPath(FString::Printf(TEXT("/Game/Maps/Unloaded%d.Unloaded%d:PersistentLevel.Door_%d"), Seed, Seed, Seed));
+		Payload.SoftPointer = TSoftObjectPtr<UObject>(FSoftObjectPath(UGameplayAbility::StaticClass()));
+		Payload.SoftClass = TSoftClassPtr<UObject>(UGameplayEffect::StaticClass());
+
+		for (int32 Index = 0; Index != 64; ++Index)
+		{
+			FGameplayAbilitySaveData& AbilityData = Payload.AbilitySystem.SavedAbilities.AddDefaulted_GetRef();
+			AbilityData.Level = Seed + Index;
+			AbilityData.AbilityClass = UGameplayAbility::StaticClass();
+			if (!Tags.IsEmpty())
+			{
+				AbilityData.DynamicTags.AddTag(Tags[(Seed + Index) % Tags.Num()]);
+			}
+
+			FGameplayEffectSaveData& EffectData = Payload.AbilitySystem.SavedGameplayEffects.AddDefaulted_GetRef();
+			EffectData.Level = static_cast<float>(Index);
+			EffectData.EffectClass = Index % 3 ? UGameplayEffect::StaticClass() : nullptr;
+
+			Payload.AbilitySystem.SavedAttributes.Add(FString::Printf(TEXT("TestSet.Attribute%d"), Index % 16), FAttributeSaveData{static_cast<float>(Index)});
+		}
+
+		return Payload;
+	}
+
+	void TestSamePayload(FAutomationTestBase& Test, const FString& What, const FTestActorPayload& Expected, const FTestActorPayload& Actual)
+	{
+		Test.TestTrue(What + TEXT(" name"), Actual.Name == Expected.Name);
+		Test.TestTrue(What + TEXT(" object"), Actual.Object == Expected.Object);
+		Test.TestNull(What + TEXT(" null object"), Actual.NullObject);
+		Test.TestTrue(What + TEXT(" soft path"), Actual.SoftPath == Expected.SoftPath);
+		Test.TestTrue(What + TEXT(" null soft path"), Actual.NullSoftPath.IsNull());
+		Test.TestTrue(What + TEXT(" soft pointer"), Actual.SoftPointer == Expected.SoftPointer);
+		Test.TestTrue(What + TEXT(" soft class"), Actual.SoftClass == Expected.SoftClass);
+		Test.TestTrue(What + TEXT(" ability system"), FAbilitySystemSaveData::StaticStruct()->CompareScriptStruct(&Expected.AbilitySystem, &Actual.AbilitySystem, 0));
+	}
+
+	void SerializeTable(FArchive& Ar, FSaveGameStringTable& Table)
+	{
+		FObjectAndNameAsStringProxyArchive Archive(Ar, Ar.IsLoading());
+		FSaveGameStringTable::StaticStruct()->SerializeItem(Archive, &Table, nullptr);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSaveGameActorArchiveTest, "SaveSystem.ActorArchive", SAVESYSTEM_TEST_FLAGS)
+
+bool FSaveGameActorArchiveTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumActors = 4;
+	TArray<FTestActorPayload> Payloads;
+	for (int32 Index = 0; Index != NumActors; ++Index)
+	{
+		Payloads.Add(MakePayload(Index));
+	}
+
+	// The second half continues the table of the first, the way a capture continues the table of the previous snapshot
+	FSaveGameStringTable Table;
+	TArray<uint8> ActorBytes;
+	TArray<int32> Offsets;
+	for (int32 Half = 0; Half != 2; ++Half)
+	{
+		FSaveGameActorArchive::FWriter Writer(Table);
+		for (int32 Index = Half * NumActors / 2; Index != (Half + 1) * NumActors / 2; ++Index)
+		{
+			Offsets.Add(ActorBytes.Num());
+			FMemoryWriter MemWriter(ActorBytes, false, true);
+			FSaveGameActorArchive Archive(MemWriter, Writer);
+			Payloads[Index].Serialize(Archive);
+		}
+		Table = Writer.MoveTable();
+	}
+
+	// Every repeated entry is stored once, also across the two halves
+	TestEqual(TEXT("Unique names"), TSet<FName>(Table.Names).Num(), Table.Names.Num());
+	TestEqual(TEXT("Unique object paths"), TSet<FString>(Table.ObjectPaths).Num(), Table.ObjectPaths.Num());
+	TestTrue(TEXT("Classes are stored once for every actor"), Table.ObjectPaths.Num() < NumActors * 2);
+
+	// The table is stored with the save, so it has to survive its own round trip
+	TArray<uint8> StoredTable;
+	{
+		FMemoryWriter MemWriter(StoredTable);
+		SerializeTable(MemWriter, Table);
+	}
+
+	FSaveGameStringTable LoadedTable;
+	{
+		FMemoryReader MemReader(StoredTable);
+		SerializeTable(MemReader, LoadedTable);
+	}
+
+	TestTrue(TEXT("Loaded table matches the written one"), LoadedTable.StartsWith(Table) && Table.StartsWith(LoadedTable));
+
+	FSaveGameActorArchive::FReader Reader(LoadedTable, false);
+	FMemoryReader MemReader(ActorBytes);
+	for (int32 Index = 0; Index != NumActors; ++Index)
+	{
+		MemReader.Seek(Offsets[Index]);
+
+		FTestActorPayload Result;
+		FSaveGameActorArchive Archive(MemReader, Reader);
+		Result.Serialize(Archive);
+
+		const FString What = FString::Printf(TEXT("Actor %d"), Index);
+		TestFalse(What + TEXT(" reads without errors"), Archive.IsError());
+		TestSamePayload(*this, What, Payloads[Index], Result);
+	}
+
+	// An index past the end of the table fails the archive instead of reading out of bounds
+	{
+		TArray<uint8> CorruptedBytes;
+		FMemoryWriter MemWriter(CorruptedBytes);
+		int32 Index = LoadedTable.Names.Num();
+		MemWriter << Index;
+
+		AddExpectedError(TEXT("which does not exist"), EAutomationExpectedErrorFlags::Contains, 1);
+
+		FMemoryReader CorruptedReader(CorruptedBytes);
+		FSaveGameActorArchive Archive(CorruptedReader, Reader);
+		FName Name;
+		Archive << Name;
+		TestTrue(TEXT("Unknown name index fails the archive"), Archive.IsError());
+		TestTrue(TEXT("Unknown name index reads None"), Name.IsNone());
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,237 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "Tests/SaveSystemTests.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "SaveGameContainer.h"
+#include "SaveGameJournal.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	void AddTestActor(FLevelActorCollection& LevelActorCollection, FName Name, const TArray<uint8>& Bytes)
+	{
+		FActorSaveData& ActorData = LevelActorCollection.SavedActors.AddDefaulted_GetRef();
+		ActorData.Name = Name;
+		ActorData.Offset = LevelActorCollection.ActorBytes.Num();
+		ActorData.Size = Bytes.Num();
+		LevelActorCollection.ActorBytes.Append(Bytes.GetData(), Bytes.Num());
+	}
+
+	// Rebuilds the collection without the actor, the way a capture leaves it out
+	void RemoveTestActor(FLevelActorCollection& LevelActorCollection, FName Name)
+	{
+		FLevelActorCollection Remaining;
+		for (const FActorSaveData& ActorData : LevelActorCollection.SavedActors)
+		{
+			if (ActorData.Name != Name)
+			{
+				Remaining.AddActor(LevelActorCollection, ActorData);
+			}
+		}
+		LevelActorCollection = MoveTemp(Remaining);
+	}
+
+	void ReplaceTestActor(FLevelActorCollection& LevelActorCollection, FName Name, const TArray<uint8>& Bytes)
+	{
+		RemoveTestActor(LevelActorCollection, Name);
+		AddTestActor(LevelActorCollection, Name, Bytes);
+	}
+
+	USaveGameData* CopySaveGame(const USaveGameData& SaveGame)
+	{
+		USaveGameData* Copy = NewObject<USaveGameData>();
+		Copy->PlayerStateSaveData = SaveGame.PlayerStateSaveData;
+		Copy->AbilitySystemSaveData = SaveGame.AbilitySystemSaveData;
+		Copy->LevelActorCollections = SaveGame.LevelActorCollections;
+		Copy->UnloadedLevelChunks = SaveGame.UnloadedLevelChunks;
+		return Copy;
+	}
+
+	void BuildIndices(USaveGameData& SaveGame)
+	{
+		for (TPair<FString, FLevelActorCollection>& Pair : SaveGame.LevelActorCollections)
+		{
+			Pair.Value.BuildIndex();
+		}
+	}
+
+	void TestSameState(FAutomationTestBase& Test, const USaveGameData& Expected, const USaveGameData& Actual)
+	{
+		Test.TestTrue(TEXT("Player transform"), Expected.PlayerStateSaveData.Transform.Equals(Actual.PlayerStateSaveData.Transform, 0.0));
+		Test.TestEqual(TEXT("Number of levels"), Actual.LevelActorCollections.Num(), Expected.LevelActorCollections.Num());
+		Test.TestTrue(TEXT("No level left encoded"), Actual.UnloadedLevelChunks.IsEmpty());
+
+		for (const TPair<FString, FLevelActorCollection>& Pair : Expected.LevelActorCollections)
+		{
+			const FLevelActorCollection* ActualCollection = Actual.LevelActorCollections.Find(Pair.Key);
+			if (!Test.TestNotNull(FString::Printf(TEXT("Level %s"), *Pair.Key), ActualCollection))
+			{
+				continue;
+			}
+
+			Test.TestEqual(FString::Printf(TEXT("Number of actors in %s"), *Pair.Key), ActualCollection->SavedActors.Num(), Pair.Value.SavedActors.Num());
+
+			for (const FActorSaveData& ActorData : Pair.Value.SavedActors)
+			{
+				const FActorSaveData* ActualData = ActualCollection->SavedActors.FindByPredicate([&ActorData](const FActorSaveData& Candidate)
+				{
+					return Candidate.Name == ActorData.Name;
+				});
+
+				const FString ActorName = FString::Printf(TEXT("Actor %s of %s"), *ActorData.Name.ToString(), *Pair.Key);
+				if (Test.TestNotNull(ActorName, ActualData))
+				{
+					const TConstArrayView<uint8> ExpectedBytes = Pair.Value.GetActorBytes(ActorData);
+					const TConstArrayView<uint8> ActualBytes = ActualCollection->GetActorBytes(*ActualData);
+					Test.TestTrue(ActorName + TEXT(" bytes"), ActualBytes.Num() == ExpectedBytes.Num()
+						&& FMemory::Memcmp(ActualBytes.GetData(), ExpectedBytes.GetData(), ExpectedBytes.Num()) == 0);
+				}
+			}
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSaveGameJournalTest, "SaveSystem.Journal", SAVESYSTEM_TEST_FLAGS)
+
+bool FSaveGameJournalTest::RunTest(const FString& Parameters)
+{
+	const FString LevelA = TEXT("/Game/Maps/LevelA");
+	const FString LevelB = TEXT("/Game/Maps/LevelB");
+	const FString LevelC = TEXT("/Game/Maps/LevelC");
+	const FString LevelD = TEXT("/Game/Maps/LevelD");
+
+	USaveGameData* Base = NewObject<USaveGameData>();
+	{
+		FLevelActorCollection& CollectionA = Base->LevelActorCollections.Add(LevelA);
+		AddTestActor(CollectionA, TEXT("A1"), {1, 2, 3});
+		AddTestActor(CollectionA, TEXT("A2"), {4, 5});
+		AddTestActor(Base->LevelActorCollections.Add(LevelB), TEXT("B1"), {6});
+		FLevelActorCollection& CollectionC = Base->LevelActorCollections.Add(LevelC);
+		AddTestActor(CollectionC, TEXT("C1"), {7, 8});
+		AddTestActor(CollectionC, TEXT("C2"), {9});
+	}
+
+	// Changed, removed and added actors, a removed level and a moved player
+	USaveGameData* First = CopySaveGame(*Base);
+	{
+		FLevelActorCollection& CollectionA = First->LevelActorCollections[LevelA];
+		ReplaceTestActor(CollectionA, TEXT("A1"), {1, 2, 10});
+		RemoveTestActor(CollectionA, TEXT("A2"));
+		AddTestActor(CollectionA, TEXT("A3"), {11, 12, 13, 14});
+		First->LevelActorCollections.Remove(LevelB);
+		ReplaceTestActor(First->LevelActorCollections[LevelC], TEXT("C2"), {15, 16});
+		First->PlayerStateSaveData.Transform.SetLocation(FVector(100.0, 0.0, 0.0));
+	}
+
+	// A new level and an actor removed from a level that stays encoded until the first record is applied
+	USaveGameData* Second = CopySaveGame(*First);
+	{
+		AddTestActor(Second->LevelActorCollections.Add(LevelD), TEXT("D1"), {17});
+		RemoveTestActor(Second->LevelActorCollections[LevelC], TEXT("C1"));
+	}
+
+	BuildIndices(*Base);
+	BuildIndices(*First);
+	BuildIndices(*Second);
+
+	FSaveGameJournalRecord FirstRecord;
+	FSaveGameJournal::Diff(*Base, *First, FirstRecord);
+	TestTrue(TEXT("First record has the player state"), FirstRecord.bHasPlayerState);
+	TestFalse(TEXT("First record has no ability system"), FirstRecord.bHasAbilitySystem);
+	TestTrue(TEXT("First record removes level B"), FirstRecord.RemovedLevels.Num() == 1 && FirstRecord.RemovedLevels[0] == LevelB);
+	TestEqual(TEXT("First record changes two levels"), FirstRecord.Levels.Num(), 2);
+
+	for (const FSaveGameJournalLevel& Level : FirstRecord.Levels)
+	{
+		TestFalse(FString::Printf(TEXT("Level %s is a difference"), *Level.Key), Level.bReplace);
+		if (Level.Key == LevelA)
+		{
+			TestEqual(TEXT("Changed actors of level A"), Level.ChangedActors.SavedActors.Num(), 2);
+			TestEqual(TEXT("Removed actors of level A"), Level.RemovedActors.Num(), 1);
+		}
+	}
+
+	FSaveGameJournalRecord SecondRecord;
+	FSaveGameJournal::Diff(*First, *Second, SecondRecord);
+	TestFalse(TEXT("Second record has no player state"), SecondRecord.bHasPlayerState);
+	TestEqual(TEXT("Second record changes two levels"), SecondRecord.Levels.Num(), 2);
+
+	// The parent has no state of the new level, so its record replaces whatever the save has
+	const FSaveGameJournalLevel* NewLevel = SecondRecord.Levels.FindByPredicate([&LevelD](const FSaveGameJournalLevel& Level)
+	{
+		return Level.Key == LevelD;
+	});
+	if (TestNotNull(TEXT("Second record adds level D"), NewLevel))
+	{
+		TestTrue(TEXT("New level replaces the collection"), NewLevel->bReplace);
+	}
+
+	const FString Filename = FPaths::CreateTempFilename(*FPaths::AutomationTransientDir(), TEXT("SaveGameJournal"), TEXT(".journal"));
+	const FGuid BaseId = FGuid::NewGuid();
+
+	TestTrue(TEXT("Creates the journal"), FSaveGameJournal::Create(Filename, BaseId));
+	TestTrue(TEXT("Appends the first record"), FSaveGameJournal::Append(Filename, FirstRecord, ESaveCompressionFormat::Fast, ESaveCompressionLevel::Normal));
+	TestTrue(TEXT("Appends the second record"), FSaveGameJournal::Append(Filename, SecondRecord, ESaveCompressionFormat::None, ESaveCompressionLevel::Normal));
+
+	// Appending only compares the id in the header of the journal with the one of the base
+	TestTrue(TEXT("Appends to the journal of its base"), FSaveGameJournal::CanAppend(Filename, BaseId, 0));
+	TestFalse(TEXT("Does not append to the journal of another base"), FSaveGameJournal::CanAppend(Filename, FGuid::NewGuid(), 0));
+	TestFalse(TEXT("Does not append past the size limit"), FSaveGameJournal::CanAppend(Filename, BaseId, 1));
+
+	// Level C is not resident when the base is read, so it stays encoded until a record changes it
+	const TSet<FString> ResidentLevels = {LevelA, LevelB, LevelD};
+	auto ReadBase = [Base, &LevelC]()
+	{
+		USaveGameData* SaveGame = CopySaveGame(*Base);
+
+		TArray<uint8> Bytes;
+		FSaveGameContainer::SerializeStruct(FLevelActorCollection::StaticStruct(), &SaveGame->LevelActorCollections[LevelC], Bytes);
+		TSharedRef<FEncodedSaveGameChunk> LevelChunk = MakeShared<FEncodedSaveGameChunk>();
+		FSaveGameContainer::Compress(Bytes, ESaveCompressionFormat::Fast, ESaveCompressionLevel::Normal, *LevelChunk);
+
+		SaveGame->LevelActorCollections.Remove(LevelC);
+		SaveGame->UnloadedLevelChunks.Add(LevelC, LevelChunk);
+		return SaveGame;
+	};
+
+	// The base is built in memory, a container without a file reads with the versions of the running build
+	const FSaveGameContainer BaseContainer;
+
+	FSaveGameJournal Journal;
+	if (TestTrue(TEXT("Opens the journal"), Journal.Open(Filename)))
+	{
+		TestTrue(TEXT("Journal base id"), Journal.GetBaseId() == BaseId);
+
+		USaveGameData* Replayed = ReadBase();
+		TestEqual(TEXT("Replayed records"), Journal.Replay(*Replayed, BaseContainer, ResidentLevels), 2);
+		TestSameState(*this, *Second, *Replayed);
+	}
+
+	// A record cut off by a crash ends the replay without losing the records before it
+	{
+		TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_Append));
+		if (TestNotNull(TEXT("Opens the journal for appending"), FileWriter.Get()))
+		{
+			uint8 TornBytes[] = {1, 2, 3};
+			FileWriter->Serialize(TornBytes, sizeof(TornBytes));
+			FileWriter->Close();
+		}
+	}
+
+	FSaveGameJournal TornJournal;
+	if (TestTrue(TEXT("Opens the torn journal"), TornJournal.Open(Filename)))
+	{
+		USaveGameData* Replayed = ReadBase();
+		TestEqual(TEXT("Replayed records of the torn journal"), TornJournal.Replay(*Replayed, BaseContainer, ResidentLevels), 2);
+		TestSameState(*this, *Second, *Replayed);
+	}
+
+	IFileManager::Get().Delete(*Filename);
+	return true;
+}
+
+#endif
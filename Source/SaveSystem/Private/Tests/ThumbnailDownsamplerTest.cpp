@@ -0,0 +1,139 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "Tests/SaveSystemTests.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "ThumbnailDownsampler.h"
+
+#include "Math/RandomStream.h"
+
+namespace
+{
+	// Straightforward box filter with the same integer rounding as FThumbnailDownsampler
+	FColor AverageBox(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight, int32 DestinationWidth,
+		int32 DestinationHeight, int32 DestinationX, int32 DestinationY)
+	{
+		const int32 BeginX = static_cast<int64>(DestinationX) * SourceWidth / DestinationWidth;
+		const int32 EndX = static_cast<int64>(DestinationX + 1) * SourceWidth / DestinationWidth;
+		const int32 BeginY = static_cast<int64>(DestinationY) * SourceHeight / DestinationHeight;
+		const int32 EndY = static_cast<int64>(DestinationY + 1) * SourceHeight / DestinationHeight;
+
+		uint32 Sums[4] = {0, 0, 0, 0};
+		for (int32 Y = BeginY; Y < EndY; ++Y)
+		{
+			for (int32 X = BeginX; X < EndX; ++X)
+			{
+				const uint8* Pixel = reinterpret_cast<const uint8*>(&Source[Y * SourceWidth + X]);
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					Sums[Channel] += Pixel[Channel];
+				}
+			}
+		}
+
+		const uint32 Count = static_cast<uint32>((EndX - BeginX) * (EndY - BeginY));
+		FColor Result;
+		uint8* ResultBytes = reinterpret_cast<uint8*>(&Result);
+		for (int32 Channel = 0; Channel < 4; ++Channel)
+		{
+			ResultBytes[Channel] = static_cast<uint8>((Sums[Channel] + Count / 2) / Count);
+		}
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FThumbnailDownsamplerTest, "SaveSystem.ThumbnailDownsampler", SAVESYSTEM_TEST_FLAGS)
+
+bool FThumbnailDownsamplerTest::RunTest(const FString& Parameters)
+{
+	// A 4x2 frame reduced to 2x1 averages two 2x2 blocks, the second one rounds half up
+	{
+		const TArray<FColor> Source = {
+			FColor(0, 0, 0, 255), FColor(4, 8, 12, 255), FColor(1, 1, 1, 0), FColor(2, 2, 2, 0),
+			FColor(8, 16, 24, 255), FColor(0, 0, 0, 255), FColor(1, 1, 1, 0), FColor(2, 2, 2, 2)
+		};
+
+		TArray<FColor> Destination;
+		TestTrue(TEXT("Downsamples a 4x2 frame"), FThumbnailDownsampler::Downsample(Source, 4, 2, Destination, 2, 1));
+		TestEqual(TEXT("Number of 4x2 to 2x1 pixels"), Destination.Num(), 2);
+		if (Destination.Num() == 2)
+		{
+			TestEqual(TEXT("First block average"), Destination[0], FColor(3, 6, 9, 255));
+			TestEqual(TEXT("Second block average"), Destination[1], FColor(2, 2, 2, 1));
+		}
+	}
+
+	// A uniform frame stays uniform at every size
+	{
+		const FColor Uniform(17, 99, 201, 128);
+		TArray<FColor> Source;
+		Source.Init(Uniform, 1920 * 1080);
+
+		TArray<FColor> Destination;
+		TestTrue(TEXT("Downsamples a uniform frame"), FThumbnailDownsampler::Downsample(Source, 1920, 1080, Destination, 228, 128));
+		TestEqual(TEXT("Number of uniform pixels"), Destination.Num(), 228 * 128);
+		TestFalse(TEXT("Uniform frame stays uniform"), Destination.ContainsByPredicate([Uniform](const FColor& Color)
+		{
+			return Color != Uniform;
+		}));
+	}
+
+	// Random frames against the reference filter, covering sizes that are no multiple of the vector width
+	const FIntPoint Cases[][2] = {
+		{{3840, 2160}, {228, 128}},
+		{{1283, 721}, {227, 131}},
+		{{7, 5}, {3, 2}},
+		{{64, 64}, {64, 64}}
+	};
+
+	FRandomStream Random(0x5A5E);
+	for (const FIntPoint* Case : Cases)
+	{
+		const FIntPoint SourceSize = Case[0];
+		const FIntPoint DestinationSize = Case[1];
+		const FString CaseName = FString::Printf(TEXT("%dx%d to %dx%d"), SourceSize.X, SourceSize.Y, DestinationSize.X, DestinationSize.Y);
+
+		TArray<FColor> Source;
+		Source.SetNumUninitialized(SourceSize.X * SourceSize.Y);
+		for (FColor& Color : Source)
+		{
+			Color.DWColor() = static_cast<uint32>(Random.GetUnsignedInt());
+		}
+
+		TArray<FColor> Vectorized;
+		TArray<FColor> Scalar;
+		TestTrue(CaseName + TEXT(" vectorized"), FThumbnailDownsampler::Downsample(Source, SourceSize.X, SourceSize.Y, Vectorized, DestinationSize.X, DestinationSize.Y));
+		TestTrue(CaseName + TEXT(" scalar"), FThumbnailDownsampler::DownsampleScalar(Source, SourceSize.X, SourceSize.Y, Scalar, DestinationSize.X, DestinationSize.Y));
+
+		const int32 NumPixels = DestinationSize.X * DestinationSize.Y;
+		if (!TestEqual(CaseName + TEXT(" vectorized pixels"), Vectorized.Num(), NumPixels) || !TestEqual(CaseName + TEXT(" scalar pixels"), Scalar.Num(), NumPixels))
+		{
+			continue;
+		}
+
+		int32 NumMismatches = 0;
+		for (int32 Y = 0; Y < DestinationSize.Y; ++Y)
+		{
+			for (int32 X = 0; X < DestinationSize.X; ++X)
+			{
+				const FColor Expected = AverageBox(Source, SourceSize.X, SourceSize.Y, DestinationSize.X, DestinationSize.Y, X, Y);
+				const int32 Index = Y * DestinationSize.X + X;
+				NumMismatches += Vectorized[Index] != Expected || Scalar[Index] != Expected ? 1 : 0;
+			}
+		}
+		TestEqual(CaseName + TEXT(" pixels that differ from the reference filter"), NumMismatches, 0);
+	}
+
+	// A destination larger than the source is rejected
+	{
+		TArray<FColor> Source;
+		Source.Init(FColor::White, 4 * 4);
+		TArray<FColor> Destination;
+		TestFalse(TEXT("Rejects upscaling"), FThumbnailDownsampler::Downsample(Source, 4, 4, Destination, 8, 4));
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,174 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "ThumbnailDownsampler.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	#include <arm_neon.h>
+	#define SAVESYSTEM_DOWNSAMPLE_NEON 1
+	#define SAVESYSTEM_DOWNSAMPLE_SSE2 0
+#elif PLATFORM_ENABLE_VECTORINTRINSICS && (PLATFORM_CPU_X86_FAMILY)
+	#include <emmintrin.h>
+	#define SAVESYSTEM_DOWNSAMPLE_NEON 0
+	#define SAVESYSTEM_DOWNSAMPLE_SSE2 1
+#else
+	#define SAVESYSTEM_DOWNSAMPLE_NEON 0
+	#define SAVESYSTEM_DOWNSAMPLE_SSE2 0
+#endif
+
+namespace
+{
+	// Accumulators hold one uint32 per channel in the byte order of FColor
+	void AccumulateRowScalar(const FColor* Row, int32 Begin, int32 Width, uint32* Accumulators)
+	{
+		const uint8* Bytes = reinterpret_cast<const uint8*>(Row);
+		for (int32 Index = Begin * 4; Index < Width * 4; ++Index)
+		{
+			Accumulators[Index] += Bytes[Index];
+		}
+	}
+
+	void AccumulateRowVectorized(const FColor* Row, int32 Width, uint32* Accumulators)
+	{
+		int32 X = 0;
+
+#if SAVESYSTEM_DOWNSAMPLE_SSE2
+		const __m128i Zero = _mm_setzero_si128();
+		for (; X + 4 <= Width; X += 4)
+		{
+			const __m128i Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row + X));
+			const __m128i Low = _mm_unpacklo_epi8(Pixels, Zero);
+			const __m128i High = _mm_unpackhi_epi8(Pixels, Zero);
+
+			__m128i* Sums = reinterpret_cast<__m128i*>(Accumulators + X * 4);
+			_mm_storeu_si128(Sums + 0, _mm_add_epi32(_mm_loadu_si128(Sums + 0), _mm_unpacklo_epi16(Low, Zero)));
+			_mm_storeu_si128(Sums + 1, _mm_add_epi32(_mm_loadu_si128(Sums + 1), _mm_unpackhi_epi16(Low, Zero)));
+			_mm_storeu_si128(Sums + 2, _mm_add_epi32(_mm_loadu_si128(Sums + 2), _mm_unpacklo_epi16(High, Zero)));
+			_mm_storeu_si128(Sums + 3, _mm_add_epi32(_mm_loadu_si128(Sums + 3), _mm_unpackhi_epi16(High, Zero)));
+		}
+#elif SAVESYSTEM_DOWNSAMPLE_NEON
+		for (; X + 4 <= Width; X += 4)
+		{
+			const uint8x16_t Pixels = vld1q_u8(reinterpret_cast<const uint8*>(Row + X));
+			const uint16x8_t Low = vmovl_u8(vget_low_u8(Pixels));
+			const uint16x8_t High = vmovl_u8(vget_high_u8(Pixels));
+
+			uint32* Sums = Accumulators + X * 4;
+			vst1q_u32(Sums + 0, vaddw_u16(vld1q_u32(Sums + 0), vget_low_u16(Low)));
+			vst1q_u32(Sums + 4, vaddw_u16(vld1q_u32(Sums + 4), vget_high_u16(Low)));
+			vst1q_u32(Sums + 8, vaddw_u16(vld1q_u32(Sums + 8), vget_low_u16(High)));
+			vst1q_u32(Sums + 12, vaddw_u16(vld1q_u32(Sums + 12), vget_high_u16(High)));
+		}
+#endif
+
+		AccumulateRowScalar(Row, X, Width, Accumulators);
+	}
+
+	void SumColumnsScalar(const uint32* Accumulators, int32 Begin, int32 End, uint32* OutSums)
+	{
+		OutSums[0] = OutSums[1] = OutSums[2] = OutSums[3] = 0;
+		for (int32 X = Begin; X < End; ++X)
+		{
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				OutSums[Channel] += Accumulators[X * 4 + Channel];
+			}
+		}
+	}
+
+	void SumColumnsVectorized(const uint32* Accumulators, int32 Begin, int32 End, uint32* OutSums)
+	{
+#if SAVESYSTEM_DOWNSAMPLE_SSE2
+		__m128i Sum = _mm_setzero_si128();
+		for (int32 X = Begin; X < End; ++X)
+		{
+			Sum = _mm_add_epi32(Sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(Accumulators + X * 4)));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(OutSums), Sum);
+#elif SAVESYSTEM_DOWNSAMPLE_NEON
+		uint32x4_t Sum = vdupq_n_u32(0);
+		for (int32 X = Begin; X < End; ++X)
+		{
+			Sum = vaddq_u32(Sum, vld1q_u32(Accumulators + X * 4));
+		}
+		vst1q_u32(OutSums, Sum);
+#else
+		SumColumnsScalar(Accumulators, Begin, End, OutSums);
+#endif
+	}
+}
+
+bool FThumbnailDownsampler::Downsample(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight,
+	TArray<FColor>& OutDestination, int32 DestinationWidth, int32 DestinationHeight)
+{
+	return DownsampleImpl<true>(Source, SourceWidth, SourceHeight, OutDestination, DestinationWidth, DestinationHeight);
+}
+
+bool FThumbnailDownsampler::DownsampleScalar(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight,
+	TArray<FColor>& OutDestination, int32 DestinationWidth, int32 DestinationHeight)
+{
+	return DownsampleImpl<false>(Source, SourceWidth, SourceHeight, OutDestination, DestinationWidth, DestinationHeight);
+}
+
+template <bool bVectorized>
+bool FThumbnailDownsampler::DownsampleImpl(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight,
+	TArray<FColor>& OutDestination, int32 DestinationWidth, int32 DestinationHeight)
+{
+	if (DestinationWidth <= 0 || DestinationHeight <= 0 || DestinationWidth > SourceWidth || DestinationHeight > SourceHeight
+		|| Source.Num() != SourceWidth * SourceHeight)
+	{
+		return false;
+	}
+
+	OutDestination.SetNumUninitialized(DestinationWidth * DestinationHeight);
+
+	TArray<uint32> Accumulators;
+	Accumulators.SetNumUninitialized(SourceWidth * 4);
+
+	for (int32 DestinationY = 0; DestinationY < DestinationHeight; ++DestinationY)
+	{
+		const int32 BeginY = static_cast<int64>(DestinationY) * SourceHeight / DestinationHeight;
+		const int32 EndY = static_cast<int64>(DestinationY + 1) * SourceHeight / DestinationHeight;
+
+		// Sum the covered source rows per column first, so every source pixel is touched only once
+		FMemory::Memzero(Accumulators.GetData(), Accumulators.Num() * sizeof(uint32));
+		for (int32 Y = BeginY; Y < EndY; ++Y)
+		{
+			const FColor* Row = Source.GetData() + static_cast<int64>(Y) * SourceWidth;
+			if constexpr (bVectorized)
+			{
+				AccumulateRowVectorized(Row, SourceWidth, Accumulators.GetData());
+			}
+			else
+			{
+				AccumulateRowScalar(Row, 0, SourceWidth, Accumulators.GetData());
+			}
+		}
+
+		FColor* DestinationRow = OutDestination.GetData() + static_cast<int64>(DestinationY) * DestinationWidth;
+		for (int32 DestinationX = 0; DestinationX < DestinationWidth; ++DestinationX)
+		{
+			const int32 BeginX = static_cast<int64>(DestinationX) * SourceWidth / DestinationWidth;
+			const int32 EndX = static_cast<int64>(DestinationX + 1) * SourceWidth / DestinationWidth;
+
+			alignas(16) uint32 Sums[4];
+			if constexpr (bVectorized)
+			{
+				SumColumnsVectorized(Accumulators.GetData(), BeginX, EndX, Sums);
+			}
+			else
+			{
+				SumColumnsScalar(Accumulators.GetData(), BeginX, EndX, Sums);
+			}
+
+			// Integer rounding keeps both paths bit identical
+			const uint32 Count = static_cast<uint32>((EndY - BeginY) * (EndX - BeginX));
+			uint8* Pixel = reinterpret_cast<uint8*>(DestinationRow + DestinationX);
+			for (int32 Channel = 0; Channel < 4; ++Channel)
+			{
+				Pixel[Channel] = static_cast<uint8>((Sums[Channel] + Count / 2) / Count);
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,26 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Box filter that reduces a BGRA frame to thumbnail size. Every destination pixel is the rounded average of the
+ * source pixels it covers. The rows are accumulated with SSE2 or NEON where available, the scalar path produces
+ * bit identical results.
+ */
+class FThumbnailDownsampler
+{
+public:
+	/** Destination must not be larger than the source in either dimension. */
+	static bool Downsample(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight,
+		TArray<FColor>& OutDestination, int32 DestinationWidth, int32 DestinationHeight);
+
+	static bool DownsampleScalar(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight,
+		TArray<FColor>& OutDestination, int32 DestinationWidth, int32 DestinationHeight);
+
+private:
+	template <bool bVectorized>
+	static bool DownsampleImpl(TConstArrayView<FColor> Source, int32 SourceWidth, int32 SourceHeight,
+		TArray<FColor>& OutDestination, int32 DestinationWidth, int32 DestinationHeight);
+};
@@ -0,0 +1,68 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "SavableActorRegistry.generated.h"
+
+struct FSavableLevelActors
+{
+	TWeakObjectPtr<ULevel> Level;
+	TSet<TWeakObjectPtr<AActor>> Actors;
+
+	// Key of the level collection in USaveGameData, see USavableActorRegistry::GetLevelKey
+	FString Key;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnSavableLevelChanged, const FSavableLevelActors&);
+
+/**
+ * Keeps track of the actors implementing ISavableObjectInterface, grouped by level, so that saving and loading
+ * do not have to iterate every actor in the world. Actors are registered when their level is added to the world
+ * or when they are spawned, and unregistered when they are destroyed or their level is removed.
+ */
+UCLASS()
+class SAVESYSTEM_API USavableActorRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Broadcast after a level was added to the world and its savable actors were registered. */
+	FOnSavableLevelChanged OnLevelAdded;
+
+	/** Broadcast before a level that is being removed from the world is dropped from the registry. */
+	FOnSavableLevelChanged OnLevelRemoving;
+
+	/** Stable name of the level that does not depend on PIE prefixes, unlike ULevel::GetName which is the same for every level. */
+	static FString GetLevelKey(const ULevel* Level);
+
+	/** Actors that are not covered by the spawn and level events can register themselves on BeginPlay. */
+	void RegisterActor(AActor* Actor);
+	void UnregisterActor(AActor* Actor);
+
+	const TMap<TObjectKey<ULevel>, FSavableLevelActors>& GetLevels() const { return Levels; }
+	const FSavableLevelActors* FindLevel(const ULevel* Level) const { return Levels.Find(Level); }
+	int32 GetNumActors() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	void RegisterLevel(ULevel* Level);
+	FSavableLevelActors& FindOrAddLevel(ULevel* Level);
+	void HandleLevelAdded(ULevel* Level, UWorld* InWorld);
+	void HandleLevelRemoved(ULevel* Level, UWorld* InWorld);
+	void HandleActorSpawned(AActor* Actor);
+	void HandleActorDestroyed(AActor* Actor);
+
+	TMap<TObjectKey<ULevel>, FSavableLevelActors> Levels;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ActorDestroyedHandle;
+};
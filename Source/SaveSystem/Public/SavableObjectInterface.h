@@ -6,6 +6,15 @@
 #include "UObject/Interface.h"
 #include "SavableObjectInterface.generated.h"
 
+enum class ESaveDirtyFlags : uint8
+{
+	None = 0,
+	Transform = 1 << 0,
+	Data = 1 << 1,
+	All = Transform | Data
+};
+ENUM_CLASS_FLAGS(ESaveDirtyFlags);
+
 // This class does not need to be modified.
 UINTERFACE(MinimalAPI)
 class USavableObjectInterface : public UInterface
@@ -24,4 +33,47 @@ class SAVESYSTEM_API ISavableObjectInterface
 public:
 	UFUNCTION(BlueprintNativeEvent)
 	void OnObjectLoaded();
+
+	/**
+	 * Objects that opt into dirty tracking are serialized again only after MarkSaveDirty or MarkSaveTransformDirty
+	 * has been called for them. Otherwise, the record from the previous save is reused.
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	bool UsesSaveDirtyTracking() const;
+
+	virtual bool UsesSaveDirtyTracking_Implementation() const { return false; }
+
+	/**
+	 * Optional id that stays the same between sessions, used to match saved records instead of the actor name.
+	 * Useful for runtime spawned actors whose names are not stable.
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	FGuid GetPersistentSaveId() const;
+
+	virtual FGuid GetPersistentSaveId_Implementation() const { return FGuid(); }
+
+	/**
+	 * Return false if serializing the SaveGame properties of this object touches state that may only be
+	 * accessed on the game thread. Only used when the parallel actor capture is enabled.
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	bool CanSerializeOffGameThread() const;
+
+	virtual bool CanSerializeOffGameThread_Implementation() const { return true; }
+
+	/**
+	 * Return true if the SaveGame properties are all the class saves, so that it can be saved through a property plan.
+	 * Classes that save state through a custom Serialize override have to keep returning false, the plan skips it.
+	 * Only used when save property plans are enabled.
+	 */
+	UFUNCTION(BlueprintNativeEvent)
+	bool CanUseSavePropertyPlan() const;
+
+	virtual bool CanUseSavePropertyPlan_Implementation() const { return false; }
+
+	/** Marks the whole saved state of the object as changed. Safe to call from any thread. */
+	static void MarkSaveDirty(const UObject* Object);
+
+	/** Marks only the transform of the object as changed, its serialized data is reused. Safe to call from any thread. */
+	static void MarkSaveTransformDirty(const UObject* Object);
 };
@@ -0,0 +1,85 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "SaveGameData.h"
+#include "Serialization/ArchiveProxy.h"
+#include "Misc/ScopeLock.h"
+
+/**
+ * Archive for the SaveGame properties of actors. Names and object references are written as indices into the
+ * string table of their level collection instead of as full strings, like FObjectAndNameAsStringProxyArchive does.
+ * When loading, every object path of the table is resolved at most once for all actors of the level.
+ */
+class SAVESYSTEM_API FSaveGameActorArchive : public FArchiveProxy
+{
+public:
+	/** Adds the strings written by every actor of a level to its table. Safe to share between worker threads. */
+	class SAVESYSTEM_API FWriter
+	{
+	public:
+		FWriter() = default;
+
+		/** Continues a table, e.g. the one of the previous snapshot of the level, so that its indices stay valid. */
+		explicit FWriter(const FSaveGameStringTable& InitialTable);
+
+		int32 AddName(FName Name);
+		int32 AddObject(UObject* Object);
+		int32 AddObjectPath(const FString& Path);
+		int32 AddPropertySchema(const FSavePropertySchema& Schema);
+
+		/** Hands the table over to the collection once every actor was written. */
+		FSaveGameStringTable MoveTable() { return MoveTemp(Table); }
+
+	private:
+		int32 AddObjectPathLocked(const FString& Path);
+
+		FSaveGameStringTable Table;
+		TMap<FName, int32> NameIndices;
+		TMap<FString, int32> PathIndices;
+		TMap<UObject*, int32> ObjectIndices;
+		TMap<uint32, int32> SchemaIndices;
+		FCriticalSection CriticalSection;
+	};
+
+	/** Resolves the entries of a table for every actor of a level. Game thread only. */
+	class SAVESYSTEM_API FReader
+	{
+	public:
+		FReader(const FSaveGameStringTable& InTable, bool bInLoadIfFindFails);
+
+		bool IsValidName(int32 Index) const { return Table.Names.IsValidIndex(Index); }
+		bool IsValidObjectPath(int32 Index) const { return Table.ObjectPaths.IsValidIndex(Index); }
+
+		FName GetName(int32 Index) const { return Table.Names[Index]; }
+		const FString& GetObjectPath(int32 Index) const { return Table.ObjectPaths[Index]; }
+		const FSavePropertySchema* FindPropertySchema(int32 Index) const { return Table.PropertySchemas.IsValidIndex(Index) ? &Table.PropertySchemas[Index] : nullptr; }
+		UObject* GetObject(int32 Index);
+
+		/** True if the valid schema at Index equals Schema, compared once for every actor of the level. */
+		bool MatchesPropertySchema(int32 Index, const FSavePropertySchema& Schema);
+
+	private:
+		const FSaveGameStringTable& Table;
+		TArray<UObject*> Objects;
+		TBitArray<> ResolvedObjects;
+		TMap<TPair<int32, const FSavePropertySchema*>, bool> PropertySchemaMatches;
+		bool bLoadIfFindFails;
+	};
+
+	FSaveGameActorArchive(FArchive& InInnerArchive, FWriter& InWriter);
+	FSaveGameActorArchive(FArchive& InInnerArchive, FReader& InReader);
+
+	virtual FArchive& operator<<(FName& Value) override;
+	virtual FArchive& operator<<(UObject*& Value) override;
+	virtual FArchive& operator<<(FObjectPtr& Value) override;
+	virtual FArchive& operator<<(FWeakObjectPtr& Value) override;
+	virtual FArchive& operator<<(FSoftObjectPtr& Value) override;
+	virtual FArchive& operator<<(FSoftObjectPath& Value) override;
+	virtual FArchive& operator<<(FLazyObjectPtr& Value) override;
+	virtual FString GetArchiveName() const override;
+
+private:
+	FWriter* Writer{nullptr};
+	FReader* Reader{nullptr};
+};
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "SaveSystemCommon.h"
 #include "GameFramework/SaveGame.h"
 #include "GameplayTagContainer.h"
 #include "SaveGameData.generated.h"
@@ -9,6 +10,54 @@
 class UGameplayAbility;
 class UGameplayEffect;
 
+struct FEncodedSaveGameChunk;
+
+UENUM()
+enum class ESavedActorFormat : uint8
+{
+	// Names and object references are stored as strings in every actor
+	NameAsString,
+	// Names and object references are indices into the string table of the level collection
+	StringTable
+};
+
+/** SaveGame properties of a class in the order their values are written by an unversioned property plan. */
+USTRUCT()
+struct FSavePropertySchema
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint32 Hash{0};
+
+	UPROPERTY()
+	TArray<FName> Names;
+
+	UPROPERTY()
+	TArray<FName> Types;
+};
+
+/** Names, object paths and property schemas referenced by the serialized actors of a level, each stored once. */
+USTRUCT()
+struct FSaveGameStringTable
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FName> Names;
+
+	UPROPERTY()
+	TArray<FString> ObjectPaths;
+
+	UPROPERTY()
+	TArray<FSavePropertySchema> PropertySchemas;
+
+	/** True if every entry of Other has the same index in this table, so actors written with Other can be read with it. */
+	bool StartsWith(const FSaveGameStringTable& Other) const;
+
+	int32 Num() const { return Names.Num() + ObjectPaths.Num() + PropertySchemas.Num(); }
+};
+
 USTRUCT()
 struct FActorSaveData
 {
@@ -17,13 +66,37 @@ struct FActorSaveData
 	UPROPERTY()
 	FName Name;
 
+	// Optional persistent id provided by ISavableObjectInterface::GetPersistentSaveId
+	UPROPERTY()
+	FGuid Guid;
+
 	UPROPERTY()
 	FTransform Transform;
 
+	// Range of the serialized actor in FLevelActorCollection::ActorBytes
+	UPROPERTY()
+	int32 Offset{0};
+
+	UPROPERTY()
+	int32 Size{0};
+
+	// Written through FSavePropertyPlan instead of UObject::Serialize
+	UPROPERTY()
+	bool bPropertyPlan{false};
+
+	// Property plan values are written by position, described by a schema of the string table
+	UPROPERTY()
+	bool bUnversioned{false};
+
+	// Written by saves from before the actor arena, moved into the arena when they are loaded
 	UPROPERTY()
 	TArray<uint8> ByteData;
 };
 
+/**
+ * Saved actors of a level. The serialized actors share a single arena instead of owning one allocation each,
+ * and records only store their range of it.
+ */
 USTRUCT()
 struct FLevelActorCollection
 {
@@ -31,6 +104,52 @@ struct FLevelActorCollection
 
 	UPROPERTY()
 	TArray<FActorSaveData> SavedActors;
+
+	UPROPERTY()
+	TArray<uint8> ActorBytes;
+
+	UPROPERTY()
+	FSaveGameStringTable StringTable;
+
+	// Saves from before the string table leave the default
+	UPROPERTY()
+	ESavedActorFormat ActorFormat{ESavedActorFormat::NameAsString};
+
+	// Size of StringTable when it was last built from scratch, captures that continue the table only add to it
+	int32 StringTableBaseSize{0};
+
+	/** Builds the lookup index used by FindActor. Has to be called again after SavedActors was modified. */
+	void BuildIndex();
+
+	/** Finds the record by persistent id if it is valid, otherwise by actor name. */
+	const FActorSaveData* FindActor(FName Name, const FGuid& Guid) const;
+	int32 FindActorIndex(FName Name, const FGuid& Guid) const;
+
+	TConstArrayView<uint8> GetActorBytes(const FActorSaveData& ActorData) const;
+
+	/** Copies a record of another collection together with its serialized actor. Both have to share the string table. */
+	FActorSaveData& AddActor(const FLevelActorCollection& Source, const FActorSaveData& ActorData);
+
+	/** Empties the collection but keeps its memory for the next capture. */
+	void Reset();
+
+	/** Content hash of the records, actor bytes and string table. Only comparable within the same session. */
+	uint64 ComputeHash() const;
+
+	void PostSerialize(const FArchive& Ar);
+
+private:
+	TMap<FName, int32> NameIndex;
+	TMap<FGuid, int32> GuidIndex;
+};
+
+template<>
+struct TStructOpsTypeTraits<FLevelActorCollection> : public TStructOpsTypeTraitsBase2<FLevelActorCollection>
+{
+	enum
+	{
+		WithPostSerialize = true
+	};
 };
 
 USTRUCT()
@@ -69,6 +188,45 @@ struct FAttributeSaveData
 	float BaseValue;
 };
 
+/** Base values of an attribute set, in the order of its FAttributeSetLayout when it was saved. */
+USTRUCT()
+struct FAttributeSetSaveData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FName SetName;
+
+	// Identifies every value, so that values can still be found by name after the layout of the set changed
+	UPROPERTY()
+	TArray<FName> AttributeNames;
+
+	UPROPERTY()
+	TArray<float> BaseValues;
+};
+
+USTRUCT()
+struct FAbilitySystemSaveData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FGameplayAbilitySaveData> SavedAbilities;
+
+	UPROPERTY()
+	TArray<FGameplayEffectSaveData> SavedGameplayEffects;
+
+	UPROPERTY()
+	TArray<FAttributeSetSaveData> SavedAttributeSets;
+
+	// Written by saves from before SavedAttributeSets. Key has the structure HealthSet.Health
+	UPROPERTY()
+	TMap<FString, FAttributeSaveData> SavedAttributes;
+
+	/** Content hash of every saved entry. Only comparable within the same session. */
+	uint64 ComputeHash() const;
+};
+
 USTRUCT()
 struct FPlayerStateSaveData
 {
@@ -79,6 +237,24 @@ struct FPlayerStateSaveData
 
 	UPROPERTY()
 	bool bResumeAtTransform{false};
+
+	uint64 ComputeHash() const;
+};
+
+/** State of one player, stored in its own file under the unique net id of the player by USaveGameSubsystem::SaveAllPlayers. */
+USTRUCT()
+struct FPlayerSaveRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString PlayerId;
+
+	UPROPERTY()
+	FPlayerStateSaveData PlayerStateSaveData;
+
+	UPROPERTY()
+	FAbilitySystemSaveData AbilitySystemSaveData;
 };
 
 /**
@@ -97,12 +273,28 @@ public:
 	TMap<FString, FLevelActorCollection> LevelActorCollections;
 
 	UPROPERTY()
-	TArray<FGameplayAbilitySaveData> SavedPlayerAbilities;
+	FAbilitySystemSaveData AbilitySystemSaveData;
+
+	/**
+	 * Levels that were not loaded while this save game was captured or read, kept as the encoded chunks of the
+	 * save file. They are written back as they are, without being deserialized and serialized again.
+	 */
+	TMap<FString, TSharedRef<const FEncodedSaveGameChunk>> UnloadedLevelChunks;
 
+	/** Empties every section for a new capture. Level collections keep their memory until the capture removes them. */
+	void Reset();
+
+	/** Moves the ability system fields of saves from before FAbilitySystemSaveData into AbilitySystemSaveData. */
+	virtual void Serialize(FArchive& Ar) override;
+
+private:
+	// Written by saves from before FAbilitySystemSaveData, only read to migrate them
 	UPROPERTY()
-	TArray<FGameplayEffectSaveData> SavedGameplayEffects;
+	TArray<FGameplayAbilitySaveData> SavedPlayerAbilities_DEPRECATED;
 
-	// Key has the structure HealthSet.Health
 	UPROPERTY()
-	TMap<FString, FAttributeSaveData> SavedAttributes;
+	TArray<FGameplayEffectSaveData> SavedGameplayEffects_DEPRECATED;
+
+	UPROPERTY()
+	TMap<FString, FAttributeSaveData> SavedAttributes_DEPRECATED;
 };
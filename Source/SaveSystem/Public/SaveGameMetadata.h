@@ -5,6 +5,9 @@
 #include "SaveGameMetadata.generated.h"
 
 class UTexture2D;
+class USaveGameMetadata;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnMetadataScreenshotLoaded, USaveGameMetadata*, Metadata);
 
 /**
  * 
@@ -15,9 +18,14 @@ class SAVESYSTEM_API USaveGameMetadata : public UObject
 	GENERATED_BODY()
 
 public:
+	/** Null until requested through USaveGameSubsystem::LoadMetadataScreenshot, and again once the cache evicts it. */
 	UPROPERTY(BlueprintReadOnly, Category = "Metadata", Transient)
 	TObjectPtr<UTexture2D> Screenshot;
 
+	/** Broadcast when a requested screenshot is available, Screenshot stays null if it could not be loaded. */
+	UPROPERTY(BlueprintAssignable, Category = "Metadata")
+	FOnMetadataScreenshotLoaded OnScreenshotLoaded;
+
 	UPROPERTY(BlueprintReadOnly, Category = "Metadata")
 	FText SlotName;
 
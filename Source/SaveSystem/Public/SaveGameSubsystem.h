@@ -2,20 +2,155 @@
 
 #pragma once
 
+#include "SaveSystemCommon.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Async/Future.h"
+#include "UObject/ObjectKey.h"
+#include "Containers/Ticker.h"
 #include "SaveGameSubsystem.generated.h"
 
 class APlayerState;
 class USaveGameData;
 class UScreenshotTaker;
+class USaveThumbnailCache;
 class USaveSystemSettings;
 class USaveGameMetadata;
 class UAbilitySystemComponent;
 class UAttributeSet;
 class UAutosaveCondition;
+class USavableActorRegistry;
+struct FEncodedSaveGameChunk;
+struct FSaveGameChunkEntry;
+struct FSaveGameMetadataIndexEntry;
+struct FSavableLevelActors;
+struct FLevelActorCollection;
+struct FActorsInitializedParams;
+enum class ESaveDirtyFlags : uint8;
 struct FGameplayAttributeData;
+struct FAbilitySystemSaveData;
+struct FPlayerSaveRecord;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnReadWriteSaveGame, USaveGameData*, SaveGameObj);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnAutosaveDeferred, float, DeferredSeconds);
+
+/** Timings of a save from the capture on the game thread until the file is written, and its sizes. */
+USTRUCT(BlueprintType)
+struct FSaveGameWriteStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	int64 UncompressedBytes{0};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	int64 CompressedBytes{0};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float CompressionSeconds{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float WriteSeconds{0.0f};
+
+	// Game thread time of SaveGameState, which includes the sections below
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float CaptureSeconds{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float WorldSeconds{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float AbilitySystemSeconds{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float PlayerSeconds{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float MetadataSeconds{0.0f};
+
+	// Time between the capture and the start of the write, spent waiting for the screenshot and earlier writes
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float QueueSeconds{0.0f};
+
+	// Background time of serializing the sections into chunks or a journal record
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	float SerializeSeconds{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	int32 NumLevels{0};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	int32 NumActors{0};
+
+	// Sections written from their encoded form of an earlier write because their content did not change
+	UPROPERTY(BlueprintReadOnly, Category = "Save System")
+	int32 NumReusedSections{0};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnSaveGameWriteStats, const FString&, SlotName, const FSaveGameWriteStats&, Stats);
+
+/** Metadata object listed by the save menu, reused as long as its metadata file does not change. */
+USTRUCT()
+struct FCachedSaveGameMetadata
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<USaveGameMetadata> Metadata;
+
+	FDateTime Timestamp;
+
+	// Thumbnail chunk of a single file slot, known if its table of contents was read for the metadata
+	TSharedPtr<const FSaveGameChunkEntry> ThumbnailEntry;
+};
+
+/**
+ * Snapshot captured on the game thread and handed over to the background writer.
+ * The referenced save game object is never modified after it has been submitted.
+ */
+USTRUCT()
+struct FSaveGameWriteRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<USaveGameData> SaveGame;
+
+	FString SlotName;
+	FString SaveFilename;
+	FString MetadataFilename;
+	FString MetadataJson;
+	FString MetadataIndexFilename;
+	TSharedPtr<const FSaveGameMetadataIndexEntry> MetadataIndexEntry;
+
+	// Encoded screenshot stored in the save file of single file slots, the write starts once it is ready
+	TSharedFuture<TArray64<uint8>> Thumbnail;
+	bool bSingleFile{false};
+
+	// Journaled slots append the difference to JournalParent, or write a full save if there is none
+	UPROPERTY()
+	TObjectPtr<USaveGameData> JournalParent;
+
+	// Base the journal belongs to as of the previous write, invalid if the slot has no journal
+	FGuid JournalBaseId;
+
+	FString JournalFilename;
+	int64 JournalMaxBytes{0};
+	bool bJournal{false};
+	ESaveCompressionFormat CompressionFormat{ESaveCompressionFormat::None};
+	ESaveCompressionLevel CompressionLevel{ESaveCompressionLevel::Normal};
+	uint32 WriteId{0};
+
+	// Capture timings of the snapshot, completed by the writer
+	FSaveGameWriteStats Stats;
+	double CaptureEndTime{0.0};
+
+	// Content hash of every section, only filled with USaveSystemSettings::bSkipUnchangedSaves
+	TMap<FString, uint64> SectionHashes;
+	bool bAutosave{false};
+
+	// Encoded sections of earlier writes with the same content, written as they are
+	TMap<FString, TSharedPtr<const FEncodedSaveGameChunk>> ReusedSections;
+};
 
 /**
  * 
@@ -29,16 +164,29 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FOnReadWriteSaveGame OnSaveGameLoaded;
 
+	/**
+	 * Broadcast once the save game has actually been written to disk by the background writer.
+	 * The snapshot is recycled by a later capture, so listeners must copy what they need instead of keeping a reference to it.
+	 */
 	UPROPERTY(BlueprintAssignable)
 	FOnReadWriteSaveGame OnSaveGameWritten;
 
+	/** Broadcast together with OnSaveGameWritten with the timing breakdown of the write, e.g. for telemetry. */
+	UPROPERTY(BlueprintAssignable)
+	FOnSaveGameWriteStats OnSaveGameWriteStats;
+
 	UPROPERTY(BlueprintAssignable)
 	FOnReadWriteSaveGame OnAutosaveStarted;
 
 	UPROPERTY(BlueprintAssignable)
 	FOnReadWriteSaveGame OnAutosaveFinished;
 
+	/** Broadcast when an autosave starts, with the time it waited for the autosave condition and frame headroom. */
+	UPROPERTY(BlueprintAssignable)
+	FOnAutosaveDeferred OnAutosaveDeferred;
+
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
 
 	UFUNCTION(BlueprintCallable, Category = "Save System")
 	virtual void LoadPlayerState();
@@ -52,6 +200,21 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Save System")
 	virtual void LoadSaveGame(FString InSlotName = "");
 
+	/**
+	 * Checks the header and table of contents of a save file without reading its chunks.
+	 * With bVerifyChecksums, every chunk is read and compared against its checksum as well.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual bool ValidateSaveGame(FString InSlotName, bool bVerifyChecksums = false) const;
+
+	/** Deletes the save file of a slot together with its metadata, screenshot, journal and metadata index entry. */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual void DeleteSaveGame(FString InSlotName);
+
+	/** Blocks until every queued and in-flight save game write has reached the disk. */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual void FlushSaveGameWrites();
+
 	UFUNCTION(BlueprintCallable, Category = "Save System")
 	virtual void LoadPlayerAbilitySystemState();
 
@@ -61,10 +224,56 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Save System")
 	virtual const TArray<USaveGameMetadata*>& GetCachedGameSaveMetadata() const { return LoadedMetadata; }
 
+	/**
+	 * Loads the screenshot of a slot listed by LoadAllSaveGameMetadata in the background.
+	 * The metadata broadcasts OnScreenshotLoaded once its Screenshot is set.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual void LoadMetadataScreenshot(USaveGameMetadata* Metadata);
+
+	/** Sizes and timings of the most recent write, to tune the compression settings per platform. */
+	UFUNCTION(BlueprintPure, Category = "Save System")
+	const FSaveGameWriteStats& GetLastWriteStats() const { return LastWriteStats; }
+
+	/**
+	 * Writes the state of every connected player to its own record, keyed by the unique net id of the player.
+	 * Every player is captured right away, the records are written in parallel over the next frames, PlayerSavesPerFrame at a time.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual void SaveAllPlayers();
+
+	/** Queues a single player the way SaveAllPlayers does, e.g. when the player leaves the server. */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual void SavePlayer(APlayerState* PlayerState);
+
+	/** Applies the record written by SaveAllPlayers to the pawn and ability system of the player. False if there is none. */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual bool LoadPlayer(APlayerState* PlayerState);
+
+	/** Blocks until all captured player records have reached the disk. */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	virtual void FlushPlayerSaves();
+
+	/** Key of the player record, empty if the player has no valid unique net id. */
+	UFUNCTION(BlueprintPure, Category = "Save System")
+	static FString GetPlayerSaveId(const APlayerState* PlayerState);
+
+	/** Blueprint access to ISavableObjectInterface::MarkSaveDirty and ISavableObjectInterface::MarkSaveTransformDirty. */
+	UFUNCTION(BlueprintCallable, Category = "Save System")
+	static void MarkSaveDirty(UObject* Object, bool bTransformOnly = false);
+
 protected:
 	UPROPERTY()
 	TObjectPtr<USaveGameData> CurrentSaveGame;
 
+	// Snapshot that CurrentSaveGame replaced, valid only while the state is being captured
+	UPROPERTY()
+	TObjectPtr<USaveGameData> PreviousSaveGame;
+
+	// Snapshot that has been written and is no longer referenced, reused by the next capture
+	UPROPERTY()
+	TObjectPtr<USaveGameData> RecycledSaveGame;
+
 	UPROPERTY()
 	TObjectPtr<USaveGameMetadata> MetadataCDO;
 
@@ -74,12 +283,79 @@ protected:
 	UPROPERTY()
 	TObjectPtr<UScreenshotTaker> ScreenshotTaker;
 
+	UPROPERTY()
+	TObjectPtr<USaveThumbnailCache> ThumbnailCache;
+
 	UPROPERTY()
 	TObjectPtr<const USaveSystemSettings> Settings;
 
 	UPROPERTY()
 	TArray<TObjectPtr<USaveGameMetadata>> LoadedMetadata;
 
+	// Keyed by the metadata file relative to the save directory
+	UPROPERTY()
+	TMap<FString, FCachedSaveGameMetadata> MetadataCache;
+
+	// At most one request per slot, newer snapshots replace older ones that have not been written yet
+	UPROPERTY()
+	TArray<FSaveGameWriteRequest> PendingWrites;
+
+	UPROPERTY()
+	FSaveGameWriteRequest InFlightWrite;
+
+	// Snapshot that the journal of the autosave slot is up to date with, null until the next full save
+	UPROPERTY()
+	TObjectPtr<USaveGameData> LastJournaledSaveGame;
+
+	// Base of the journal of the autosave slot, kept from its write so that appends never read the base file
+	FGuid JournalBaseId;
+
+	TFuture<bool> WriteTask;
+	uint32 WriteCounter;
+
+	// Filled by the background writer, read on the game thread once the write has finished
+	TSharedPtr<FSaveGameWriteStats> InFlightWriteStats;
+	FSaveGameWriteStats LastWriteStats;
+
+	// Filled while SaveGameState captures a snapshot, handed over to its write request
+	FSaveGameWriteStats CaptureStats;
+
+	// Section hashes of the snapshot captured last and of the autosave that was written last. Manual saves are not
+	// compared against, an autosave after a manual save of the same state is still written to the autosave slots.
+	TMap<FString, uint64> CaptureSectionHashes;
+	TMap<FString, uint64> LastAutosaveSectionHashes;
+
+	// Encoded sections of earlier writes with the hash of the content they were encoded from
+	TMap<FString, TPair<uint64, TSharedPtr<const FEncodedSaveGameChunk>>> WrittenSections;
+
+	// Encoded sections of the in-flight write, filled by the background writer
+	TSharedPtr<TMap<FString, TSharedPtr<const FEncodedSaveGameChunk>>> InFlightWriteSections;
+
+	// Journal base of the slot after the in-flight write, filled by the background writer
+	TSharedPtr<FGuid> InFlightJournalBaseId;
+
+	// Screenshot requested for the snapshot that is captured next, handed over to its write request
+	TSharedFuture<TArray64<uint8>> PendingThumbnail;
+
+	// Starts the pending writes again once the screenshot wait of one of them runs out
+	FTSTicker::FDelegateHandle ScreenshotTimeoutTickerHandle;
+
+	// Records captured by SaveAllPlayers that wait for their write, at most one per player id
+	TArray<TSharedRef<const FPlayerSaveRecord>> PendingPlayerRecords;
+
+	// Player records being written, at most one per player id
+	TMap<FString, TFuture<bool>> PlayerWriteTasks;
+
+	FTSTicker::FDelegateHandle PlayerSaveTickerHandle;
+
+	// Encoded state of levels that are not loaded right now, carried into every snapshot until they stream in again
+	TMap<FString, TSharedRef<const FEncodedSaveGameChunk>> UnloadedLevelChunks;
+
+	// Levels that already received the state of the current save game since they were added to the world
+	TSet<FString> AppliedLevels;
+
+	FDelegateHandle WorldInitializedActorsHandle;
+
 	FString CurrentSlotName;
 	FString CurrentMetadataFilename;
 
@@ -87,32 +363,83 @@ protected:
 
 	int32 AutosaveCounter;
 
+	double AutosaveRequestTime;
+	double AutosaveHeadroomWaitStartTime;
+	float AutosaveCurrentRetryDelay;
+	float SmoothedFrameTime;
+
 	virtual void SaveGameState();
+	virtual void CaptureGameState();
 	virtual void SaveWorldState();
 	virtual void SaveAbilitySystemState();
 	virtual void SavePlayerState();
 	virtual void HandleAutosave();
+	virtual void TryStartAutosave();
+	virtual void PerformAutosave();
 	virtual UAbilitySystemComponent* FindPlayerAbilitySystemComponent() const;
+	virtual UAbilitySystemComponent* FindAbilitySystemComponent(const APlayerState* PlayerState) const;
+	virtual void CapturePlayerRecord(APlayerState* PlayerState, FPlayerSaveRecord& OutRecord) const;
+	virtual void ApplyPlayerRecord(APlayerState* PlayerState, const FPlayerSaveRecord& Record);
 	virtual void OverrideSpawnTransform();
+	virtual void ApplyLevelState(const FSavableLevelActors& LevelActors, const FLevelActorCollection& LevelActorCollection);
+
+	/** Finds the saved actors of a level, falling back to the single collection of saves from before per-level keys. */
+	const FLevelActorCollection* FindLevelActorCollection(const FString& LevelKey) const;
+
+	void CaptureLevelActors(TConstArrayView<const FSavableLevelActors*> Levels, const USaveGameData* PreviousSnapshot,
+		const TMap<FObjectKey, ESaveDirtyFlags>& DirtyObjects, TMap<FString, FLevelActorCollection>& OutCollections) const;
+
+	void CaptureAbilitySystem(UAbilitySystemComponent* ASC, FAbilitySystemSaveData& OutData) const;
+	void ApplyAbilitySystem(UAbilitySystemComponent* ASC, const FAbilitySystemSaveData& Data);
+	void ApplyAbilitySystemBatched(UAbilitySystemComponent* ASC, const FAbilitySystemSaveData& Data);
+	void ApplyAttributeSets(UAbilitySystemComponent* ASC, const FAbilitySystemSaveData& Data);
+	bool TickPlayerSaves(float DeltaTime);
+	void StartPlayerWrite(const TSharedRef<const FPlayerSaveRecord>& Record);
+	void CollectFinishedPlayerWrites();
+
+	void HandleWorldInitializedActors(const FActorsInitializedParams& Params);
+	void HandleLevelAdded(const FSavableLevelActors& LevelActors);
+	void HandleLevelRemoving(const FSavableLevelActors& LevelActors);
+	void BindToRegistry(USavableActorRegistry* Registry);
 
 	UFUNCTION()
-	virtual void HandleScreenshotTaken(const TArray<uint8>& ScreenshotBytes);
+	virtual void HandleScreenshotTaken(const FString& Filename, bool bSuccess);
 
-	void SaveGameToSlot();
-	void SaveMetadata();
-	USaveGameMetadata* ReadMetadata(const FString& MetadataPath) const;
+	void SaveGameToSlot(bool bAutosave = false);
+	void StartNextWrite();
+	bool HandleScreenshotTimeout(float DeltaTime);
+	void HandleWriteFinished(uint32 WriteId, bool bSuccess);
+	bool IsSnapshotInUse(const USaveGameData* SaveGame) const;
+	void ComputeSectionHashes();
+	bool IsCaptureUnchanged() const;
+	bool SerializeMetadata(FString& OutJsonString) const;
+	USaveGameMetadata* ReadMetadata(const FString& MetadataPath, TSharedPtr<const FSaveGameChunkEntry>* OutThumbnailEntry = nullptr) const;
 	
-	void RequestScreenshot() const;
-	UTexture2D* LoadScreenshot(const FString& MetadataPath) const;
+	void RequestScreenshot();
 	
 	bool CanRequestScreenshot() const;
 	FString GetSaveDirectory() const;
+	FString GetMetadataIndexFilename() const;
+	FString GetSaveFilename(const FString& SlotName) const;
+	FString GetJournalFilename(const FString& SlotName) const;
+	FString GetPlayerSaveFilename(const FString& PlayerId) const;
+	bool IsJournalSlot(const FString& SlotName) const;
+	FString GetFullSlotName(const FString& SlotName) const;
 	FString GetScreenshotFilename() const;
 	FString GetScreenshotFormat() const;
+	FString GetThumbnailFilename(const FString& MetadataPath) const;
 	FString GetAttributeName(const FProperty* Property) const;
 	FString GetAutosaveSlotName();
 	int32 GetAutosaveIndex();
 	FGameplayAttributeData* GetAttributeData(FProperty* Property, UAttributeSet* AttrSet);
 	APlayerState* GetPlayerState() const;
+	USavableActorRegistry* GetSavableActorRegistry() const;
 	void CreateSaveGameDataObject();
+	USaveGameData* NewSaveGameDataObject() const;
+	USaveGameData* ReadSaveGameFromDisk(const FString& SlotName) const;
+
+	static bool WriteSaveGameToDisk(const FSaveGameWriteRequest& Request, FSaveGameWriteStats& OutStats,
+		TMap<FString, TSharedPtr<const FEncodedSaveGameChunk>>& OutSections, FGuid& OutJournalBaseId);
+	static bool WritePlayerRecordToDisk(const FPlayerSaveRecord& Record, const FString& Filename,
+		ESaveCompressionFormat CompressionFormat, ESaveCompressionLevel CompressionLevel);
 };
@@ -0,0 +1,61 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "SaveGameData.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * SaveGame properties of a class with their offsets, found once instead of walking every property of the object
+ * through UObject::Serialize. Tagged payloads write each value with its name, type and size. Unversioned payloads
+ * write only the values, described by the schema of the class that the level stores once. Both stay readable after
+ * properties were added, removed or changed their type, such values are skipped and keep their current state.
+ */
+class SAVESYSTEM_API FSavePropertyPlan
+{
+public:
+	/** Plan of the class, built on first use. Game thread only, the returned plan can be used on any thread. */
+	static const FSavePropertyPlan& Get(const UClass* Class);
+
+	/** Serializes the properties of the plan with tags, the archive has to be saving or loading Object. */
+	void Serialize(FArchive& Ar, UObject* Object) const;
+
+	/**
+	 * Layout: Values... | Sizes...
+	 * The sizes trail the values, so a payload of the current schema is read without touching them.
+	 */
+	void SaveUnversioned(FArchive& Ar, UObject* Object) const;
+
+	/**
+	 * Reads by position if the saved schema matches the plan, otherwise matches the saved values by name and type.
+	 * The caller compares the schemas once for every actor of a level, see FSaveGameActorArchive::FReader::MatchesPropertySchema.
+	 * The payload has to end where the archive ends.
+	 */
+	void LoadUnversioned(FArchive& Ar, UObject* Object, const FSavePropertySchema& SavedSchema, bool bSchemaMatches) const;
+
+	const FSavePropertySchema& GetSchema() const { return Schema; }
+	int32 GetNumProperties() const { return Entries.Num(); }
+
+private:
+	struct FEntry
+	{
+		FProperty* Property;
+		int32 Offset;
+		int32 ElementSize;
+		int32 ArrayDim;
+		FName Name;
+
+		// C++ type including template arguments, e.g. TArray<FVector>
+		FName Type;
+	};
+
+	explicit FSavePropertyPlan(const UClass* Class);
+
+	void SerializeValue(FArchive& Ar, const FEntry& Entry, UObject* Object) const;
+
+	const FEntry* FindEntry(FName Name, FName Type) const;
+
+	TArray<FEntry> Entries;
+	TMap<FName, int32> EntryIndices;
+	FSavePropertySchema Schema;
+};
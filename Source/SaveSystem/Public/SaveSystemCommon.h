@@ -8,3 +8,22 @@ enum class EScreenshotFormat : uint8
 	JPEG UMETA(DisplayName = "JPEG"),
 	PNG UMETA(DisplayName = "PNG")
 };
+
+UENUM(BlueprintType)
+enum class ESaveCompressionFormat : uint8
+{
+	None UMETA(DisplayName = "None"),
+	Fast UMETA(DisplayName = "Fast (Oodle Mermaid)"),
+	HighRatio UMETA(DisplayName = "High Ratio (Oodle Leviathan)")
+};
+
+UENUM(BlueprintType)
+enum class ESaveCompressionLevel : uint8
+{
+	HyperFast,
+	SuperFast,
+	VeryFast,
+	Fast,
+	Normal,
+	Optimal
+};
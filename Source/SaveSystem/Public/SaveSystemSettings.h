@@ -25,6 +25,13 @@ public:
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "General")
 	bool bCreateSeparateFolderForSave;
 
+	/**
+	 * Stores the metadata and the screenshot of a slot as sections of its save file instead of separate json and image files,
+	 * so that every save is a single sequential write. The save menu reads only the sections it needs.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "General")
+	bool bSingleFileSlots;
+
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave")
 	bool bEnableAutosave;
 
@@ -44,6 +51,51 @@ public:
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave"))
 	TSubclassOf<UAutosaveCondition> AutosaveConditionClass;
 
+	/**
+	 * Autosaves append the changes since the previous autosave to a journal and only write a full save now and then,
+	 * so that their cost follows the amount of changed state. All autosaves go to a single slot in this mode.
+	 * The journal is a plain file next to the slot, so it is only used where the platform save system keeps slots as plain
+	 * files in the SaveGames directory, like the generic save system of desktop platforms. Elsewhere every autosave is a full save.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave"))
+	bool bJournaledAutosave;
+
+	/** Once the journal has grown past this size, the next autosave writes a full save and starts a new journal. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bJournaledAutosave", ClampMin = 1, Units = "KB"))
+	int32 AutosaveJournalMaxKilobytes;
+
+	/**
+	 * Delay in seconds before the autosave condition is checked again after it has rejected an autosave.
+	 * The delay grows by AutosaveRetryBackoff after every rejection, up to AutosaveMaxRetryDelay.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave", ClampMin = 0.0f, Units = "s"))
+	float AutosaveRetryDelay;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave", ClampMin = 1.0f))
+	float AutosaveRetryBackoff;
+
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave", ClampMin = 0.0f, Units = "s"))
+	float AutosaveMaxRetryDelay;
+
+	/**
+	 * Autosave starts only on a frame whose smoothed frame time is below this budget, so that the capture
+	 * does not land on frames that are already over budget. Zero, the default, disables the headroom check.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave", ClampMin = 0.0f, Units = "ms"))
+	float AutosaveFrameTimeBudget;
+
+	/** Once an autosave has been deferred for this long because of frame headroom, it starts on the next frame anyway. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Autosave", meta = (EditCondition = "bEnableAutosave", ClampMin = 0.0f, Units = "s"))
+	float AutosaveMaxHeadroomDeferral;
+
+	/** Codec used for the chunks of the save file. Compression runs on the background writer. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Compression")
+	ESaveCompressionFormat SaveCompressionFormat;
+
+	/** Higher levels trade compression time for smaller files, decompression speed is barely affected. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Compression", meta = (EditCondition = "SaveCompressionFormat != ESaveCompressionFormat::None"))
+	ESaveCompressionLevel SaveCompressionLevel;
+
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Metadata")
 	bool bCreateMetadata;
 
@@ -59,6 +111,7 @@ public:
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Screenshot", meta = (EditCondition = "bTakeScreenshot"))
 	EScreenshotFormat ScreenshotFormat;
 
+	/** Reduces the captured frame to Width x Height with a box filter on the encode thread. */
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Screenshot", meta = (EditCondition = "bTakeScreenshot"))
 	bool bUseCustomScreenshotDimensions;
 
@@ -68,8 +121,68 @@ public:
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Screenshot", meta = (EditCondition = "bUseCustomScreenshotDimensions", ClampMin = 1, ClampMax = 2160))
 	int32 Height;
 
+	/** Number of screenshot textures kept loaded for the save menu. Zero removes the limit. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Screenshot", meta = (EditCondition = "bTakeScreenshot", ClampMin = 0))
+	int32 ScreenshotCacheMaxCount;
+
+	/** Memory budget for loaded screenshot textures. Zero removes the limit. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Screenshot", meta = (EditCondition = "bTakeScreenshot", ClampMin = 0, Units = "MB"))
+	int32 ScreenshotCacheMaxMegabytes;
+
+	/** Time a single file slot waits for its screenshot after the capture before it is written without one. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Screenshot", meta = (EditCondition = "bTakeScreenshot", ClampMin = 0, Units = "s"))
+	float ScreenshotTimeoutSeconds;
+
 	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Advanced")
 	bool bSetControllerRotationAfterLoadingPlayerState;
+
+	/**
+	 * Serializes savable actors on task graph workers instead of the game thread. Actors that are not safe to
+	 * serialize off the game thread can opt out through ISavableObjectInterface::CanSerializeOffGameThread.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Performance")
+	bool bParallelActorCapture;
+
+	/** Below this number of actors to serialize, the capture stays on the game thread. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Performance", meta = (EditCondition = "bParallelActorCapture", ClampMin = 1))
+	int32 ParallelCaptureMinActors;
+
+	/**
+	 * Serializes only the SaveGame properties of savable actors, through offsets cached per class, instead of walking
+	 * every property in UObject::Serialize. Actors opt in through ISavableObjectInterface::CanUseSavePropertyPlan.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Performance")
+	bool bUseSavePropertyPlans;
+
+	/**
+	 * Writes property plan values by position without per-value tags. The schema of each class is stored once per level,
+	 * and values are matched by name only when the class changed since the save.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Performance", meta = (EditCondition = "bUseSavePropertyPlans"))
+	bool bUnversionedPropertyPlans;
+
+	/**
+	 * Restores abilities under one ability list lock and effects under one effect container lock, with attribute
+	 * aggregator updates deferred until the whole ability system state was applied, instead of one update per entry.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Performance")
+	bool bBatchAbilitySystemRestore;
+
+	/**
+	 * Hashes every captured section. Autosaves are skipped when nothing changed since the last autosave, which also
+	 * keeps the older autosaves. Manual saves do not count, so the first autosave after one is still written.
+	 * Sections that did not change are written from their encoded form of the last write instead of being serialized
+	 * and compressed again.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Performance")
+	bool bSkipUnchangedSaves;
+
+	/**
+	 * Player record writes started per frame by USaveGameSubsystem::SaveAllPlayers. Every player is captured in the frame
+	 * of the call, only the writes of the rest wait for the next frames. 0 starts all writes at once.
+	 */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Players", meta = (ClampMin = 0))
+	int32 PlayerSavesPerFrame;
 	
 	USaveSystemSettings(const FObjectInitializer& Initializer);
 };
@@ -4,9 +4,12 @@
 
 #include "SaveSystemCommon.h"
 #include "Containers/ContainersFwd.h"
+#include "Async/Future.h"
 #include "ScreenshotTaker.generated.h"
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnScreenshotTaken, const TArray<uint8>&, ImageData);
+class IImageWrapperModule;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnScreenshotTaken, const FString&, Filename, bool, bSuccess);
 
 /**
  * Idea taken from https://gist.github.com/alanedwardes/282e54302bcdffbf51de440600091ea5
@@ -17,6 +20,7 @@ class SAVESYSTEM_API UScreenshotTaker : public UObject
 	GENERATED_BODY()
 
 public:
+	/** Broadcast on the game thread once the encoded screenshot has been written to its file or handed to its future. */
 	UPROPERTY(BlueprintAssignable, Category = "Screenshot")
 	FOnScreenshotTaken OnScreenshotTaken;
 	
@@ -27,12 +31,26 @@ public:
 	void SetImageFormat(EScreenshotFormat InImageFormat) { ScreenshotFormat = InImageFormat; }
 	void SetCompressionRate(int32 InCompressionRate) { CompressionRate = InCompressionRate; }
 	
+	/** Captures the next frame, then encodes it and writes it to Filename on a worker thread. */
 	UFUNCTION(BlueprintCallable, Category = "Screenshot")
-	virtual void RequestScreenshot();
+	virtual void RequestScreenshot(const FString& Filename);
+
+	/**
+	 * Captures the next frame and encodes it in memory for callers that store the image themselves.
+	 * The future holds an empty array if the capture could not be started or the encode failed.
+	 */
+	TSharedFuture<TArray64<uint8>> RequestScreenshotData();
 
 protected:
+	bool BeginCapture();
 	virtual void AcceptScreenshot(int32 InSizeX, int32 InSizeY, const TArray<FColor>& InImageData);
 
+	static bool EncodeScreenshot(IImageWrapperModule& WrapperModule, EScreenshotFormat Format, int32 Quality,
+		int32 SizeX, int32 SizeY, const TArray<FColor>& Pixels, TArray64<uint8>& OutCompressedImage);
+
+	IImageWrapperModule* ImageWrapperModule;
+	FString RequestedFilename;
+	TSharedPtr<TPromise<TArray64<uint8>>> RequestedData;
 	bool bIsScreenshotRequested;
 	EScreenshotFormat ScreenshotFormat;
 	int32 CompressionRate;
@@ -41,6 +41,7 @@ public class SaveSystem : ModuleRules
 				"DeveloperSettings",
 				"GameplayAbilities",
 				"GameplayTags",
+				"ImageWrapper",
 				"JsonUtilities",
 				"Json",
 			}
@@ -0,0 +1,34 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveBenchmarkResults.h"
+#include "SaveSystemLogChannels.h"
+
+#include "Serialization/JsonSerializer.h"
+#include "Misc/DateTime.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+void AddSaveBenchmarkEnvironment(FJsonObject& Json)
+{
+	Json.SetStringField(TEXT("engine_version"), FEngineVersion::Current().ToString());
+	Json.SetStringField(TEXT("platform"), FPlatformProperties::IniPlatformName());
+	Json.SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+}
+
+bool WriteSaveBenchmarkResults(const TSharedRef<FJsonObject>& Json, const FString& Name)
+{
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Json, Writer);
+
+	const FString Filename = FPaths::ProfilingDir() / TEXT("SaveSystem") / FString::Printf(TEXT("%s-%s.json"), *Name, *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(Output, *Filename))
+	{
+		UE_LOG(LogSaveSystem, Error, TEXT("Failed to write the save system benchmark results to %s"), *Filename);
+		return false;
+	}
+
+	UE_LOG(LogSaveSystem, Display, TEXT("Save system benchmark results written to %s"), *FPaths::ConvertRelativePathToFull(Filename));
+	return true;
+}
@@ -0,0 +1,11 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "Dom/JsonObject.h"
+
+/** Adds the engine version, platform and time of the run to the results of a benchmark. */
+void AddSaveBenchmarkEnvironment(FJsonObject& Json);
+
+/** Writes the results of a benchmark to Saved/Profiling/SaveSystem/<Name>-<Time>.json. */
+bool WriteSaveBenchmarkResults(const TSharedRef<FJsonObject>& Json, const FString& Name);
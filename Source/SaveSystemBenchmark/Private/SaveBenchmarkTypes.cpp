@@ -0,0 +1,131 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveBenchmarkTypes.h"
+
+#include "GameplayTagsManager.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SaveBenchmarkTypes)
+
+ASaveBenchmarkSmallActor::ASaveBenchmarkSmallActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+}
+
+void ASaveBenchmarkSmallActor::FillSaveData(FRandomStream& Random)
+{
+	Health = Random.RandRange(1, 100);
+	Stamina = Random.FRand();
+	bOpened = Random.RandRange(0, 1) == 1;
+	Variant = FName(TEXT("Variant"), Random.RandRange(0, 15));
+}
+
+void ASaveBenchmarkMediumActor::FillSaveData(FRandomStream& Random)
+{
+	Super::FillSaveData(Random);
+
+	Velocity = Random.VRand() * 100.0f;
+	AimRotation = FRotator(Random.FRandRange(-90.0f, 90.0f), Random.FRandRange(-180.0f, 180.0f), 0.0f);
+	Label = FString::Printf(TEXT("Benchmark actor %d"), Random.RandRange(0, 9999));
+	State = static_cast<ESaveBenchmarkState>(Random.RandRange(0, 2));
+	SpawnClass = AActor::StaticClass();
+
+	static const TArray<FGameplayTag> AllTags = []
+	{
+		FGameplayTagContainer Container;
+		UGameplayTagsManager::Get().RequestAllGameplayTags(Container, true);
+		return Container.GetGameplayTagArray();
+	}();
+
+	Tags.Reset();
+	for (int32 Index = FMath::Min(AllTags.Num(), Random.RandRange(0, 3)); Index > 0; --Index)
+	{
+		Tags.AddTag(AllTags[Random.RandHelper(AllTags.Num())]);
+	}
+
+	Counters.SetNum(Random.RandRange(0, 8));
+	for (int32& Counter : Counters)
+	{
+		Counter = Random.RandRange(0, 1000);
+	}
+}
+
+void ASaveBenchmarkLargeActor::FillSaveData(FRandomStream& Random)
+{
+	Super::FillSaveData(Random);
+
+	Waypoints.SetNum(Random.RandRange(4, 32));
+	for (FVector& Waypoint : Waypoints)
+	{
+		Waypoint = Random.VRand() * 1000.0f;
+	}
+
+	Notes.SetNum(Random.RandRange(0, 4));
+	for (FString& Note : Notes)
+	{
+		Note = FString::Printf(TEXT("Note %d"), Random.RandRange(0, 9999));
+	}
+
+	for (int32 Index = Random.RandRange(4, 16); Index > 0; --Index)
+	{
+		Inventory.Add(FName(TEXT("Item"), Random.RandRange(0, 63)), Random.RandRange(1, 99));
+	}
+
+	Sockets.SetNum(Random.RandRange(0, 8));
+	for (FTransform& Socket : Sockets)
+	{
+		Socket.SetLocation(Random.VRand() * 50.0f);
+	}
+
+	KnownClasses = {AActor::StaticClass(), ASaveBenchmarkSmallActor::StaticClass(), StaticClass()};
+}
+
+void ASaveBenchmarkWideActor::FillSaveData(FRandomStream& Random)
+{
+	Super::FillSaveData(Random);
+
+	// The values are declared as arrays of several types, so they are filled through reflection
+	for (TFieldIterator<FProperty> It(GetClass()); It; ++It)
+	{
+		if (!It->GetOwnerClass()->IsChildOf(ASaveBenchmarkWideActor::StaticClass()))
+		{
+			continue;
+		}
+
+		for (int32 ArrayIndex = 0; ArrayIndex != It->ArrayDim; ++ArrayIndex)
+		{
+			void* Value = It->ContainerPtrToValuePtr<void>(this, ArrayIndex);
+			if (const FNumericProperty* NumericProperty = CastField<FNumericProperty>(*It))
+			{
+				if (NumericProperty->IsFloatingPoint())
+				{
+					NumericProperty->SetFloatingPointPropertyValue(Value, Random.FRand());
+				}
+				else
+				{
+					NumericProperty->SetIntPropertyValue(Value, static_cast<int64>(Random.RandRange(0, 255)));
+				}
+			}
+			else if (const FNameProperty* NameProperty = CastField<FNameProperty>(*It))
+			{
+				NameProperty->SetPropertyValue(Value, FName(TEXT("Variant"), Random.RandRange(0, 15)));
+			}
+			else if (const FStructProperty* StructProperty = CastField<FStructProperty>(*It))
+			{
+				if (StructProperty->Struct == TBaseStructure<FVector>::Get())
+				{
+					*static_cast<FVector*>(Value) = Random.VRand() * 100.0f;
+				}
+				else if (StructProperty->Struct == TBaseStructure<FRotator>::Get())
+				{
+					*static_cast<FRotator*>(Value) = FRotator(Random.FRandRange(-90.0f, 90.0f), Random.FRandRange(-180.0f, 180.0f), 0.0f);
+				}
+			}
+		}
+	}
+}
+
+USaveBenchmarkEffect::USaveBenchmarkEffect()
+{
+	DurationPolicy = EGameplayEffectDurationType::Infinite;
+}
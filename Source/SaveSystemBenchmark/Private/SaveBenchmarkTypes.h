@@ -0,0 +1,274 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#pragma once
+
+#include "SavableObjectInterface.h"
+#include "GameFramework/Actor.h"
+#include "AttributeSet.h"
+#include "Abilities/GameplayAbility.h"
+#include "GameplayEffect.h"
+#include "GameplayTagContainer.h"
+#include "SaveBenchmarkTypes.generated.h"
+
+UENUM()
+enum class ESaveBenchmarkState : uint8
+{
+	Idle,
+	Active,
+	Broken
+};
+
+/** Savable actor with a few scalar SaveGame properties. */
+UCLASS(NotPlaceable, Transient)
+class ASaveBenchmarkSmallActor : public AActor, public ISavableObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	ASaveBenchmarkSmallActor();
+
+	/** Fills the SaveGame properties with values that differ from the defaults. */
+	virtual void FillSaveData(FRandomStream& Random);
+
+	virtual bool CanUseSavePropertyPlan_Implementation() const override { return true; }
+
+	UPROPERTY(SaveGame)
+	int32 Health{0};
+
+	UPROPERTY(SaveGame)
+	float Stamina{0.0f};
+
+	UPROPERTY(SaveGame)
+	bool bOpened{false};
+
+	UPROPERTY(SaveGame)
+	FName Variant;
+};
+
+/** Adds strings, structs, enums, tags and object references. */
+UCLASS(NotPlaceable, Transient)
+class ASaveBenchmarkMediumActor : public ASaveBenchmarkSmallActor
+{
+	GENERATED_BODY()
+
+public:
+	virtual void FillSaveData(FRandomStream& Random) override;
+
+	UPROPERTY(SaveGame)
+	FVector Velocity{FVector::ZeroVector};
+
+	UPROPERTY(SaveGame)
+	FRotator AimRotation{FRotator::ZeroRotator};
+
+	UPROPERTY(SaveGame)
+	FString Label;
+
+	UPROPERTY(SaveGame)
+	ESaveBenchmarkState State{ESaveBenchmarkState::Idle};
+
+	UPROPERTY(SaveGame)
+	FGameplayTagContainer Tags;
+
+	UPROPERTY(SaveGame)
+	TSoftClassPtr<AActor> SpawnClass;
+
+	UPROPERTY(SaveGame)
+	TArray<int32> Counters;
+};
+
+/** Adds containers of variable size. */
+UCLASS(NotPlaceable, Transient)
+class ASaveBenchmarkLargeActor : public ASaveBenchmarkMediumActor
+{
+	GENERATED_BODY()
+
+public:
+	virtual void FillSaveData(FRandomStream& Random) override;
+
+	UPROPERTY(SaveGame)
+	TArray<FVector> Waypoints;
+
+	UPROPERTY(SaveGame)
+	TArray<FString> Notes;
+
+	UPROPERTY(SaveGame)
+	TMap<FName, int32> Inventory;
+
+	UPROPERTY(SaveGame)
+	TArray<FTransform> Sockets;
+
+	UPROPERTY(SaveGame)
+	TArray<TObjectPtr<UClass>> KnownClasses;
+};
+
+/**
+ * Savable actor with more than a hundred SaveGame values in fixed size arrays of different types. UObject::Serialize writes a tag
+ * for every element of such an array, property plans write the values without tags.
+ */
+UCLASS(NotPlaceable, Transient)
+class ASaveBenchmarkWideActor : public ASaveBenchmarkSmallActor
+{
+	GENERATED_BODY()
+
+public:
+	virtual void FillSaveData(FRandomStream& Random) override;
+
+	UPROPERTY(SaveGame)
+	int32 Ints[16]{};
+
+	UPROPERTY(SaveGame)
+	int64 Int64s[16]{};
+
+	UPROPERTY(SaveGame)
+	uint8 Bytes[16]{};
+
+	UPROPERTY(SaveGame)
+	float Floats[16]{};
+
+	UPROPERTY(SaveGame)
+	double Doubles[16]{};
+
+	UPROPERTY(SaveGame)
+	FName Names[16];
+
+	UPROPERTY(SaveGame)
+	FVector Vectors[16];
+
+	UPROPERTY(SaveGame)
+	FRotator Rotators[16];
+};
+
+/** Adds another 256 SaveGame values. */
+UCLASS(NotPlaceable, Transient)
+class ASaveBenchmarkWiderActor : public ASaveBenchmarkWideActor
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(SaveGame)
+	int32 MoreInts[32]{};
+
+	UPROPERTY(SaveGame)
+	int64 MoreInt64s[32]{};
+
+	UPROPERTY(SaveGame)
+	uint8 MoreBytes[32]{};
+
+	UPROPERTY(SaveGame)
+	float MoreFloats[32]{};
+
+	UPROPERTY(SaveGame)
+	double MoreDoubles[32]{};
+
+	UPROPERTY(SaveGame)
+	FName MoreNames[32];
+
+	UPROPERTY(SaveGame)
+	FVector MoreVectors[32];
+
+	UPROPERTY(SaveGame)
+	FRotator MoreRotators[32];
+};
+
+/** Attributes are found through the class that declares them, so every attribute set of the benchmark is a class of its own. */
+UCLASS()
+class USaveBenchmarkAttributeSetA : public UAttributeSet
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	FGameplayAttributeData Attribute00;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute01;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute02;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute03;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute04;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute05;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute06;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute07;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute08;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute09;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute10;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute11;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute12;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute13;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute14;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute15;
+};
+
+UCLASS()
+class USaveBenchmarkAttributeSetB : public UAttributeSet
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	FGameplayAttributeData Attribute00;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute01;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute02;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute03;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute04;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute05;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute06;
+
+	UPROPERTY()
+	FGameplayAttributeData Attribute07;
+};
+
+UCLASS()
+class USaveBenchmarkAbility : public UGameplayAbility, public ISavableObjectInterface
+{
+	GENERATED_BODY()
+};
+
+/** Infinite effect without modifiers, so that it stays active and is captured by every save. */
+UCLASS()
+class USaveBenchmarkEffect : public UGameplayEffect, public ISavableObjectInterface
+{
+	GENERATED_BODY()
+
+public:
+	USaveBenchmarkEffect();
+};
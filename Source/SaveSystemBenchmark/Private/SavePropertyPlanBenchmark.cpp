@@ -0,0 +1,184 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveBenchmarkTypes.h"
+#include "SaveBenchmarkResults.h"
+#include "SavePropertyPlan.h"
+#include "SaveGameActorArchive.h"
+#include "SaveSystemLogChannels.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+namespace
+{
+	/** Time and payload size of one way of serializing an actor, summed over every actor and iteration. */
+	struct FPropertyPlanPhase
+	{
+		double Seconds{0.0};
+		int64 Bytes{0};
+
+		template<typename FunctionType>
+		void MeasureSave(FSaveGameActorArchive::FWriter& Writer, TArray<uint8>& OutBytes, FunctionType&& Function)
+		{
+			OutBytes.Reset();
+			const double StartTime = FPlatformTime::Seconds();
+			{
+				FMemoryWriter MemWriter(OutBytes);
+				FSaveGameActorArchive Archive(MemWriter, Writer);
+				Archive.ArIsSaveGame = true;
+				Function(Archive);
+			}
+			Seconds += FPlatformTime::Seconds() - StartTime;
+			Bytes += OutBytes.Num();
+		}
+
+		template<typename FunctionType>
+		void MeasureLoad(FSaveGameActorArchive::FReader& Reader, const TArray<uint8>& InBytes, FunctionType&& Function)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			{
+				FMemoryReader MemReader(InBytes);
+				FSaveGameActorArchive Archive(MemReader, Reader);
+				Archive.ArIsSaveGame = true;
+				Function(Archive);
+			}
+			Seconds += FPlatformTime::Seconds() - StartTime;
+			Bytes += InBytes.Num();
+		}
+
+		TSharedRef<FJsonObject> ToJson(int32 NumSerialized) const
+		{
+			TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+			Json->SetNumberField(TEXT("seconds_total"), Seconds);
+			Json->SetNumberField(TEXT("microseconds_per_actor"), Seconds * 1e6 / NumSerialized);
+			Json->SetNumberField(TEXT("bytes_per_actor"), static_cast<double>(Bytes) / NumSerialized);
+			return Json;
+		}
+	};
+
+	/** Serializes the actors of one class through UObject::Serialize and through both payloads of its property plan. */
+	TSharedRef<FJsonObject> BenchmarkClass(UClass* Class, TConstArrayView<AActor*> Actors, int32 NumIterations)
+	{
+		const FSavePropertyPlan& Plan = FSavePropertyPlan::Get(Class);
+
+		FPropertyPlanPhase Serialize;
+		FPropertyPlanPhase TaggedSave;
+		FPropertyPlanPhase UnversionedSave;
+		FPropertyPlanPhase TaggedLoad;
+		FPropertyPlanPhase UnversionedLoad;
+
+		TArray<uint8> SerializeBytes;
+		TArray<uint8> TaggedBytes;
+		TArray<uint8> UnversionedBytes;
+
+		for (int32 Iteration = 0; Iteration != NumIterations; ++Iteration)
+		{
+			for (AActor* Actor : Actors)
+			{
+				FSaveGameActorArchive::FWriter Writer;
+				Serialize.MeasureSave(Writer, SerializeBytes, [Actor](FArchive& Ar) { Actor->Serialize(Ar); });
+				TaggedSave.MeasureSave(Writer, TaggedBytes, [&Plan, Actor](FArchive& Ar) { Plan.Serialize(Ar, Actor); });
+				UnversionedSave.MeasureSave(Writer, UnversionedBytes, [&Plan, Actor](FArchive& Ar) { Plan.SaveUnversioned(Ar, Actor); });
+
+				// Reading the values just written leaves the actor as it was
+				const FSaveGameStringTable Table = Writer.MoveTable();
+				FSaveGameActorArchive::FReader Reader(Table, false);
+				TaggedLoad.MeasureLoad(Reader, TaggedBytes, [&Plan, Actor](FArchive& Ar) { Plan.Serialize(Ar, Actor); });
+				UnversionedLoad.MeasureLoad(Reader, UnversionedBytes, [&Plan, Actor](FArchive& Ar) { Plan.LoadUnversioned(Ar, Actor, Plan.GetSchema(), true); });
+			}
+		}
+
+		// Fixed size arrays are a single property with a value per element
+		int32 NumProperties = 0;
+		int32 NumSaveGameValues = 0;
+		for (TFieldIterator<FProperty> It(Class, EFieldIterationFlags::IncludeSuper); It; ++It)
+		{
+			++NumProperties;
+			if (It->HasAnyPropertyFlags(CPF_SaveGame))
+			{
+				NumSaveGameValues += It->ArrayDim;
+			}
+		}
+
+		const int32 NumSerialized = NumIterations * Actors.Num();
+		UE_LOG(LogSaveSystem, Display, TEXT("%s: %d SaveGame properties with %d values. Serialize %.2f us, plan %.2f us, unversioned plan %.2f us per actor"),
+			*Class->GetName(), Plan.GetNumProperties(), NumSaveGameValues, Serialize.Seconds * 1e6 / NumSerialized, TaggedSave.Seconds * 1e6 / NumSerialized,
+			UnversionedSave.Seconds * 1e6 / NumSerialized);
+
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("class"), Class->GetName());
+		Json->SetNumberField(TEXT("properties"), NumProperties);
+		Json->SetNumberField(TEXT("save_game_properties"), Plan.GetNumProperties());
+		Json->SetNumberField(TEXT("save_game_values"), NumSaveGameValues);
+		Json->SetObjectField(TEXT("serialize"), Serialize.ToJson(NumSerialized));
+		Json->SetObjectField(TEXT("plan_save"), TaggedSave.ToJson(NumSerialized));
+		Json->SetObjectField(TEXT("unversioned_plan_save"), UnversionedSave.ToJson(NumSerialized));
+		Json->SetObjectField(TEXT("plan_load"), TaggedLoad.ToJson(NumSerialized));
+		Json->SetObjectField(TEXT("unversioned_plan_load"), UnversionedLoad.ToJson(NumSerialized));
+		return Json;
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkPropertyPlanCommand(
+	TEXT("SaveSystem.BenchmarkPropertyPlan"),
+	TEXT("Times UObject::Serialize against the tagged and unversioned property plans on synthetic actors with up to hundreds of SaveGame ")
+	TEXT("values and writes the results as JSON to Saved/Profiling/SaveSystem. Usage: SaveSystem.BenchmarkPropertyPlan [Iterations=100] [ActorsPerClass=64]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World)
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("The property plan benchmark needs a world to spawn its actors in"));
+			return;
+		}
+
+		const int32 NumIterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 100;
+		const int32 NumActorsPerClass = Args.Num() > 1 ? FMath::Max(1, FCString::Atoi(*Args[1])) : 64;
+
+		// From a handful of SaveGame values to hundreds of them, to show where the plans start to pay off
+		const TSubclassOf<ASaveBenchmarkSmallActor> Classes[] = {
+			ASaveBenchmarkSmallActor::StaticClass(),
+			ASaveBenchmarkMediumActor::StaticClass(),
+			ASaveBenchmarkLargeActor::StaticClass(),
+			ASaveBenchmarkWideActor::StaticClass(),
+			ASaveBenchmarkWiderActor::StaticClass()
+		};
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		FRandomStream Random(NumActorsPerClass);
+
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		AddSaveBenchmarkEnvironment(*Json);
+		Json->SetNumberField(TEXT("iterations"), NumIterations);
+		Json->SetNumberField(TEXT("actors_per_class"), NumActorsPerClass);
+
+		TArray<TSharedPtr<FJsonValue>> ClassResults;
+		for (TSubclassOf<ASaveBenchmarkSmallActor> Class : Classes)
+		{
+			TArray<AActor*> Actors;
+			for (int32 Index = 0; Index != NumActorsPerClass; ++Index)
+			{
+				if (ASaveBenchmarkSmallActor* Actor = World->SpawnActor<ASaveBenchmarkSmallActor>(Class, FTransform::Identity, SpawnParameters))
+				{
+					Actor->FillSaveData(Random);
+					Actors.Add(Actor);
+				}
+			}
+
+			if (!Actors.IsEmpty())
+			{
+				ClassResults.Add(MakeShared<FJsonValueObject>(BenchmarkClass(Class, Actors, NumIterations)));
+			}
+
+			for (AActor* Actor : Actors)
+			{
+				Actor->Destroy();
+			}
+		}
+
+		Json->SetArrayField(TEXT("classes"), ClassResults);
+		WriteSaveBenchmarkResults(Json, TEXT("PropertyPlan"));
+	}));
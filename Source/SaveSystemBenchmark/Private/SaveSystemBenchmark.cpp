@@ -0,0 +1,483 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "SaveBenchmarkTypes.h"
+#include "SaveBenchmarkResults.h"
+#include "SaveGameSubsystem.h"
+#include "SaveSystemSettings.h"
+#include "SaveSystemLogChannels.h"
+
+#include "AbilitySystemComponent.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/MallocBase.h"
+#include "Kismet/GameplayStatics.h"
+
+namespace
+{
+	/**
+	 * Counts allocations while it is installed as GMalloc. Every call is forwarded to the allocator it replaced,
+	 * so memory allocated before, during and after the measurement can be freed through either of them.
+	 */
+	class FSaveBenchmarkMallocCounter final : public FMalloc
+	{
+	public:
+		explicit FSaveBenchmarkMallocCounter(FMalloc* InInner) : Inner(InInner) {}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		/** Wraps the allocator installed on first use. Never freed, a thread may still be inside it after it was uninstalled. */
+		static FSaveBenchmarkMallocCounter& Get()
+		{
+			static FSaveBenchmarkMallocCounter* Counter = new FSaveBenchmarkMallocCounter(GMalloc);
+			return *Counter;
+		}
+
+		int64 GetNumAllocations() const { return NumAllocations.load(std::memory_order_relaxed); }
+
+	private:
+		FMalloc* Inner;
+		std::atomic<int64> NumAllocations{0};
+	};
+
+	/**
+	 * Installs the counter as GMalloc for its lifetime and puts the previous allocator back on every way out of the
+	 * scope, so an early return can't leave the counter installed. Scopes may nest.
+	 *
+	 * GMalloc is swapped on the game thread while task graph and pool threads keep allocating. The pointer is written
+	 * without synchronization, so another thread may still call the previous allocator for a moment or already call the
+	 * counter. Both are safe because the counter forwards every call to the allocator it wraps, so a block is freed by
+	 * the allocator that made it whichever pointer a thread used. Allocations of every thread are counted while the
+	 * counter is installed, including those of the background save writes.
+	 */
+	class FScopedSaveBenchmarkMallocCounter
+	{
+	public:
+		explicit FScopedSaveBenchmarkMallocCounter(FSaveBenchmarkMallocCounter& Counter)
+			: Previous(GMalloc)
+		{
+			check(IsInGameThread());
+			GMalloc = &Counter;
+		}
+
+		~FScopedSaveBenchmarkMallocCounter()
+		{
+			GMalloc = Previous;
+		}
+
+		UE_NONCOPYABLE(FScopedSaveBenchmarkMallocCounter);
+
+	private:
+		FMalloc* Previous;
+	};
+
+	/** Wall time, allocations and memory of every run of a phase. */
+	struct FSaveBenchmarkPhase
+	{
+		FString Name;
+		TArray<double> Seconds;
+		int64 NumAllocations{0};
+		int64 BytesWritten{0};
+		int64 UsedPhysicalDelta{0};
+
+		TSharedRef<FJsonObject> ToJson() const
+		{
+			TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+			Json->SetStringField(TEXT("name"), Name);
+			Json->SetNumberField(TEXT("runs"), Seconds.Num());
+
+			double TotalSeconds = 0.0;
+			for (double Value : Seconds)
+			{
+				TotalSeconds += Value;
+			}
+
+			Json->SetNumberField(TEXT("wall_seconds_total"), TotalSeconds);
+			Json->SetNumberField(TEXT("wall_seconds_mean"), Seconds.IsEmpty() ? 0.0 : TotalSeconds / Seconds.Num());
+			Json->SetNumberField(TEXT("wall_seconds_min"), Seconds.IsEmpty() ? 0.0 : FMath::Min(Seconds));
+			Json->SetNumberField(TEXT("wall_seconds_max"), Seconds.IsEmpty() ? 0.0 : FMath::Max(Seconds));
+			Json->SetNumberField(TEXT("allocations"), static_cast<double>(NumAllocations));
+			Json->SetNumberField(TEXT("bytes_written"), static_cast<double>(BytesWritten));
+			Json->SetNumberField(TEXT("used_physical_delta_bytes"), static_cast<double>(UsedPhysicalDelta));
+			return Json;
+		}
+	};
+
+	/**
+	 * Fills the world of the command with synthetic savable actors and the player ability system with sets, abilities
+	 * and effects, then times the save and load entry points of USaveGameSubsystem for every actor count.
+	 */
+	class FSaveSystemBenchmark
+	{
+	public:
+		FSaveSystemBenchmark(UWorld* InWorld, USaveGameSubsystem* InSubsystem, int32 InNumSlots)
+			: World(InWorld)
+			, Subsystem(InSubsystem)
+			, NumSlots(InNumSlots)
+			, MallocCounter(FSaveBenchmarkMallocCounter::Get())
+		{
+		}
+
+		TSharedRef<FJsonObject> Run(TConstArrayView<int32> ActorCounts)
+		{
+			// No viewport to capture under -nullrhi, and the screenshot would dominate the write time anyway
+			USaveSystemSettings* Settings = GetMutableDefault<USaveSystemSettings>();
+			const bool bTakeScreenshot = Settings->bTakeScreenshot;
+			Settings->bTakeScreenshot = false;
+
+			TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+			AddSaveBenchmarkEnvironment(*Json);
+			Json->SetNumberField(TEXT("slots"), NumSlots);
+			Json->SetObjectField(TEXT("settings"), SettingsToJson(*Settings));
+
+			SetUpAbilitySystem(*Json);
+
+			TArray<TSharedPtr<FJsonValue>> Runs;
+			for (int32 NumActors : ActorCounts)
+			{
+				Runs.Add(MakeShared<FJsonValueObject>(RunWithActors(NumActors)));
+			}
+			Json->SetArrayField(TEXT("runs"), Runs);
+			Json->SetArrayField(TEXT("ability_system_restore"), RunAbilitySystemRestore(*Settings));
+
+			TearDownAbilitySystem();
+			DeleteSlots();
+			Settings->bTakeScreenshot = bTakeScreenshot;
+			return Json;
+		}
+
+	private:
+		template<typename FunctionType>
+		void Measure(FSaveBenchmarkPhase& Phase, FunctionType&& Function)
+		{
+			FScopedSaveBenchmarkMallocCounter ScopedCounter(MallocCounter);
+
+			const uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+			const int64 NumAllocations = MallocCounter.GetNumAllocations();
+
+			const double StartTime = FPlatformTime::Seconds();
+			Function();
+			Phase.Seconds.Add(FPlatformTime::Seconds() - StartTime);
+
+			Phase.NumAllocations += MallocCounter.GetNumAllocations() - NumAllocations;
+			Phase.UsedPhysicalDelta += static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<int64>(UsedPhysical);
+		}
+
+		TSharedRef<FJsonObject> RunWithActors(int32 NumActors)
+		{
+			UE_LOG(LogSaveSystem, Display, TEXT("Save system benchmark with %d actors"), NumActors);
+
+			TArray<AActor*> Actors = SpawnActors(NumActors);
+			Subsystem->FlushSaveGameWrites();
+
+			FSaveBenchmarkPhase Capture{TEXT("WriteSaveGame.Capture")};
+			FSaveBenchmarkPhase Write{TEXT("WriteSaveGame")};
+			FSaveBenchmarkPhase Load{TEXT("LoadSaveGame")};
+			FSaveBenchmarkPhase LoadAbilitySystem{TEXT("LoadPlayerAbilitySystemState")};
+			FSaveBenchmarkPhase LoadMetadata{TEXT("LoadAllSaveGameMetadata")};
+
+			for (int32 Slot = 0; Slot != NumSlots; ++Slot)
+			{
+				const FString SlotName = GetSlotName(Slot);
+				Measure(Write, [this, &Capture, &SlotName]
+				{
+					// Capture on the game thread, then the background write until it reached the disk
+					Measure(Capture, [this, &SlotName] { Subsystem->WriteSaveGame(SlotName); });
+					Subsystem->FlushSaveGameWrites();
+				});
+				Write.BytesWritten += Subsystem->GetLastWriteStats().CompressedBytes;
+			}
+
+			for (int32 Slot = 0; Slot != NumSlots; ++Slot)
+			{
+				const FString SlotName = GetSlotName(Slot);
+				Measure(Load, [this, &SlotName] { Subsystem->LoadSaveGame(SlotName); });
+				Measure(LoadAbilitySystem, [this] { Subsystem->LoadPlayerAbilitySystemState(); });
+			}
+
+			for (int32 Slot = 0; Slot != NumSlots; ++Slot)
+			{
+				Measure(LoadMetadata, [this] { Subsystem->LoadAllSaveGameMetadata(); });
+			}
+
+			for (AActor* Actor : Actors)
+			{
+				if (IsValid(Actor))
+				{
+					Actor->Destroy();
+				}
+			}
+
+			TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+			Json->SetNumberField(TEXT("actors"), NumActors);
+
+			// Peak of the whole process up to the end of this run, not of a single phase
+			Json->SetNumberField(TEXT("process_peak_used_physical_bytes"), static_cast<double>(FPlatformMemory::GetStats().PeakUsedPhysical));
+
+			TArray<TSharedPtr<FJsonValue>> Phases;
+			for (const FSaveBenchmarkPhase* Phase : {&Capture, &Write, &Load, &LoadAbilitySystem, &LoadMetadata})
+			{
+				Phases.Add(MakeShared<FJsonValueObject>(Phase->ToJson()));
+			}
+			Json->SetArrayField(TEXT("phases"), Phases);
+			return Json;
+		}
+
+		/** Restores the same ability system state with the per-entry loop and with the batched restore. */
+		TArray<TSharedPtr<FJsonValue>> RunAbilitySystemRestore(USaveSystemSettings& Settings)
+		{
+			UE_LOG(LogSaveSystem, Display, TEXT("Save system benchmark of the ability system restore"));
+
+			// The runs above granted the saved state again with every load, so the slot is saved from the initial state
+			RemoveGrantedState();
+			GrantState();
+			const FString SlotName = GetSlotName(0);
+			Subsystem->WriteSaveGame(SlotName);
+			Subsystem->LoadSaveGame(SlotName);
+
+			const bool bBatchAbilitySystemRestore = Settings.bBatchAbilitySystemRestore;
+			FSaveBenchmarkPhase Loop{TEXT("LoadPlayerAbilitySystemState.Loop")};
+			FSaveBenchmarkPhase Batched{TEXT("LoadPlayerAbilitySystemState.Batched")};
+
+			for (FSaveBenchmarkPhase* Phase : {&Loop, &Batched})
+			{
+				Settings.bBatchAbilitySystemRestore = Phase == &Batched;
+				for (int32 Run = 0; Run != NumSlots; ++Run)
+				{
+					// Every run restores into an ability system without the saved abilities and effects
+					RemoveGrantedState();
+
+					Measure(*Phase, [this] { Subsystem->LoadPlayerAbilitySystemState(); });
+				}
+			}
+
+			Settings.bBatchAbilitySystemRestore = bBatchAbilitySystemRestore;
+			return {MakeShared<FJsonValueObject>(Loop.ToJson()), MakeShared<FJsonValueObject>(Batched.ToJson())};
+		}
+
+		TArray<AActor*> SpawnActors(int32 NumActors)
+		{
+			const TSubclassOf<ASaveBenchmarkSmallActor> Classes[] = {
+				ASaveBenchmarkSmallActor::StaticClass(),
+				ASaveBenchmarkMediumActor::StaticClass(),
+				ASaveBenchmarkLargeActor::StaticClass()
+			};
+
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+			// The same seed for every run, so that the actor counts are comparable
+			FRandomStream Random(NumActors);
+
+			TArray<AActor*> Actors;
+			Actors.Reserve(NumActors);
+			for (int32 Index = 0; Index != NumActors; ++Index)
+			{
+				const FTransform Transform(FRotator(0.0f, Random.FRandRange(0.0f, 360.0f), 0.0f), Random.VRand() * 10000.0f);
+				ASaveBenchmarkSmallActor* Actor = World->SpawnActor<ASaveBenchmarkSmallActor>(Classes[Index % UE_ARRAY_COUNT(Classes)], Transform, SpawnParameters);
+				if (Actor)
+				{
+					Actor->FillSaveData(Random);
+					Actors.Add(Actor);
+				}
+			}
+
+			return Actors;
+		}
+
+		void SetUpAbilitySystem(FJsonObject& Json)
+		{
+			APlayerState* PlayerState = UGameplayStatics::GetPlayerState(World, 0);
+			ASC = PlayerState->FindComponentByClass<UAbilitySystemComponent>();
+			if (!ASC)
+			{
+				ASC = NewObject<UAbilitySystemComponent>(PlayerState, TEXT("SaveBenchmarkAbilitySystem"));
+				ASC->RegisterComponent();
+				ASC->InitAbilityActorInfo(PlayerState, PlayerState->GetPawn());
+				bCreatedASC = true;
+			}
+
+			const TSubclassOf<UAttributeSet> SetClasses[] = {
+				USaveBenchmarkAttributeSetA::StaticClass(),
+				USaveBenchmarkAttributeSetB::StaticClass()
+			};
+
+			for (TSubclassOf<UAttributeSet> SetClass : SetClasses)
+			{
+				UAttributeSet* AttributeSet = NewObject<UAttributeSet>(PlayerState, SetClass);
+				ASC->AddSpawnedAttribute(AttributeSet);
+				AttributeSets.Add(AttributeSet);
+			}
+
+			GrantState();
+
+			TSharedRef<FJsonObject> AbilitySystemJson = MakeShared<FJsonObject>();
+			AbilitySystemJson->SetNumberField(TEXT("attribute_sets"), AttributeSets.Num());
+			AbilitySystemJson->SetNumberField(TEXT("abilities"), NumAbilities);
+			AbilitySystemJson->SetNumberField(TEXT("effects"), NumEffects);
+			Json.SetObjectField(TEXT("ability_system"), AbilitySystemJson);
+		}
+
+		void GrantState()
+		{
+			for (int32 Index = 0; Index != NumAbilities; ++Index)
+			{
+				ASC->GiveAbility(FGameplayAbilitySpec(USaveBenchmarkAbility::StaticClass(), Index % 10 + 1));
+			}
+
+			const UGameplayEffect* Effect = GetDefault<USaveBenchmarkEffect>();
+			for (int32 Index = 0; Index != NumEffects; ++Index)
+			{
+				ASC->ApplyGameplayEffectToSelf(Effect, Index % 5 + 1, ASC->MakeEffectContext());
+			}
+		}
+
+		/** Loading gives the saved abilities and effects again, so everything of the benchmark types is removed. */
+		void RemoveGrantedState()
+		{
+			for (const FGameplayAbilitySpec& Spec : TArray<FGameplayAbilitySpec>(ASC->GetActivatableAbilities()))
+			{
+				if (Spec.Ability && Spec.Ability->IsA<USaveBenchmarkAbility>())
+				{
+					ASC->ClearAbility(Spec.Handle);
+				}
+			}
+
+			FGameplayEffectQuery Query;
+			Query.EffectDefinition = USaveBenchmarkEffect::StaticClass();
+			ASC->RemoveActiveEffects(Query);
+		}
+
+		void TearDownAbilitySystem()
+		{
+			if (!IsValid(ASC))
+			{
+				return;
+			}
+
+			if (bCreatedASC)
+			{
+				ASC->DestroyComponent();
+				return;
+			}
+
+			RemoveGrantedState();
+
+			for (UAttributeSet* AttributeSet : AttributeSets)
+			{
+				ASC->RemoveSpawnedAttribute(AttributeSet);
+			}
+		}
+
+		// The benchmark writes into the save directory of the project, so its slots must not show up in the save menu afterwards
+		void DeleteSlots()
+		{
+			for (int32 Slot = 0; Slot != NumSlots; ++Slot)
+			{
+				Subsystem->DeleteSaveGame(GetSlotName(Slot));
+			}
+		}
+
+		static TSharedRef<FJsonObject> SettingsToJson(const USaveSystemSettings& Settings)
+		{
+			TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+			Json->SetBoolField(TEXT("single_file_slots"), Settings.bSingleFileSlots);
+			Json->SetBoolField(TEXT("parallel_actor_capture"), Settings.bParallelActorCapture);
+			Json->SetBoolField(TEXT("save_property_plans"), Settings.bUseSavePropertyPlans);
+			Json->SetBoolField(TEXT("unversioned_property_plans"), Settings.bUnversionedPropertyPlans);
+			Json->SetBoolField(TEXT("batch_ability_system_restore"), Settings.bBatchAbilitySystemRestore);
+			Json->SetBoolField(TEXT("skip_unchanged_saves"), Settings.bSkipUnchangedSaves);
+			Json->SetStringField(TEXT("compression_format"), UEnum::GetValueAsString(Settings.SaveCompressionFormat));
+			Json->SetStringField(TEXT("compression_level"), UEnum::GetValueAsString(Settings.SaveCompressionLevel));
+			return Json;
+		}
+
+		static FString GetSlotName(int32 Slot)
+		{
+			return FString::Printf(TEXT("SaveBenchmark%02d"), Slot);
+		}
+
+		static constexpr int32 NumAbilities = 256;
+		static constexpr int32 NumEffects = 128;
+
+		UWorld* World;
+		USaveGameSubsystem* Subsystem;
+		int32 NumSlots;
+
+		UAbilitySystemComponent* ASC{nullptr};
+		bool bCreatedASC{false};
+		TArray<UAttributeSet*> AttributeSets;
+		FSaveBenchmarkMallocCounter& MallocCounter;
+	};
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+	TEXT("SaveSystem.Benchmark"),
+	TEXT("Times saving and loading synthetic worlds and writes the results as JSON to Saved/Profiling/SaveSystem. Meant for an empty map, ")
+	TEXT("e.g. -game -nullrhi -ExecCmds=\"SaveSystem.Benchmark\". Usage: SaveSystem.Benchmark [Slots=8] [ActorCounts=1000,10000,100000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USaveGameSubsystem* Subsystem = World && World->GetGameInstance() ? World->GetGameInstance()->GetSubsystem<USaveGameSubsystem>() : nullptr;
+		APlayerState* PlayerState = Subsystem ? UGameplayStatics::GetPlayerState(World, 0) : nullptr;
+		if (!PlayerState || !PlayerState->GetPawn())
+		{
+			UE_LOG(LogSaveSystem, Error, TEXT("The save system benchmark needs a game world with a player pawn"));
+			return;
+		}
+
+		const int32 NumSlots = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 8;
+
+		TArray<int32> ActorCounts = {1000, 10000, 100000};
+		if (Args.Num() > 1)
+		{
+			TArray<FString> Counts;
+			Args[1].ParseIntoArray(Counts, TEXT(","));
+
+			ActorCounts.Reset();
+			for (const FString& Count : Counts)
+			{
+				ActorCounts.Add(FMath::Max(1, FCString::Atoi(*Count)));
+			}
+		}
+
+		FSaveSystemBenchmark Benchmark(World, Subsystem, NumSlots);
+		WriteSaveBenchmarkResults(Benchmark.Run(ActorCounts), TEXT("Benchmark"));
+	}));
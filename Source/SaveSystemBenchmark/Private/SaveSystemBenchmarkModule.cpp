@@ -0,0 +1,5 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, SaveSystemBenchmark)
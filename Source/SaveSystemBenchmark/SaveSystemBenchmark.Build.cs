@@ -0,0 +1,24 @@
+// Copyright Kyrylo Zaverukha. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class SaveSystemBenchmark : ModuleRules
+{
+	public SaveSystemBenchmark(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"CoreUObject",
+				"Engine",
+				"GameplayAbilities",
+				"GameplayTags",
+				"Json",
+				"SaveSystem",
+			}
+			);
+	}
+}